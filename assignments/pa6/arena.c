@@ -0,0 +1,51 @@
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+void arena_init(arena_t *arena) { arena->current = NULL; }
+
+void arena_free(arena_t *arena) {
+  arena_release(arena->current); // the filling reference
+  arena->current = NULL;
+}
+
+char *arena_reserve(arena_t *arena, size_t len) {
+  arena_page_t *page = arena->current;
+  size_t capacity = ARENA_PAGE_SIZE - sizeof(arena_page_t);
+
+  if (page == NULL || capacity - page->used < len) {
+    // retire the full page, resolvers free it once they are done with it
+    arena_release(page);
+
+    page = malloc(ARENA_PAGE_SIZE);
+    if (page == NULL) {
+      fprintf(stderr, "Failed to allocate memory\n");
+      arena->current = NULL;
+      return NULL;
+    }
+    page->refs = 1;
+    page->used = 0;
+    arena->current = page;
+  }
+
+  return page->data + page->used;
+}
+
+void arena_commit(arena_t *arena, size_t len, name_handle_t *handle) {
+  arena_page_t *page = arena->current;
+
+  handle->name = page->data + page->used;
+  handle->len = len - 1;
+  handle->page = page;
+  page->used += len;
+  __atomic_add_fetch(&page->refs, 1, __ATOMIC_RELAXED);
+}
+
+void arena_release(void *page) {
+  if (page == NULL)
+    return;
+
+  arena_page_t *p = page;
+  if (__atomic_sub_fetch(&p->refs, 1, __ATOMIC_ACQ_REL) == 0)
+    free(p);
+}
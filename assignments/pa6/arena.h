@@ -0,0 +1,38 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include "array.h"
+#include <stddef.h>
+
+#define ARENA_PAGE_SIZE (64 * 1024) // bytes of names per page
+
+// a page of names, freed once every name on it has been released
+typedef struct {
+  int refs;    // live names + 1 while the page is still being filled
+  size_t used; // bytes handed out
+  char data[];
+} arena_page_t;
+
+// per-requester bump allocator for hostnames
+// only the owning thread allocates, any thread may release
+typedef struct {
+  arena_page_t *current;
+} arena_t;
+
+void arena_init(arena_t *arena);
+// retires the current page; it is freed once its names are released
+void arena_free(arena_t *arena);
+
+/* Returns room for at least len bytes at the end of the current page
+** The caller writes the name there directly and then commits it, so a
+** name is written exactly once on its way to the resolvers
+*/
+char *arena_reserve(arena_t *arena, size_t len);
+
+// claims len bytes (name + \0) of the last reservation for handle
+void arena_commit(arena_t *arena, size_t len, name_handle_t *handle);
+
+// drops one name's reference to page (NULL is ignored)
+void arena_release(void *page);
+
+#endif
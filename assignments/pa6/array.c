@@ -0,0 +1,136 @@
+#include "array.h"
+#include <errno.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+void synchronize_init(array *s) {
+  sem_init(&s->mutex, PSHARED, 1);
+  sem_init(&s->full, PSHARED, 0);
+  sem_init(&s->empty, PSHARED, ARRAY_SIZE);
+
+  return;
+}
+
+// a signal handler (the daemon's stop) interrupts sem_wait without taking
+// the semaphore, so waits are retried; any other failure is reported
+static int wait_retry(sem_t *sem) {
+  while (sem_wait(sem) == -1) {
+    if (errno != EINTR) {
+      perror("sem_wait");
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int array_init(array *s) {
+  synchronize_init(s);
+  sem_wait(&s->mutex);
+
+  s->head = 0;
+  s->tail = 0;
+  s->puts = 0;
+  // slots hold handles only, nothing to allocate per slot
+  memset(s->arr, 0, sizeof(s->arr));
+
+  sem_post(&s->mutex);
+
+  return 0;
+}
+
+int array_put(array *s, const name_handle_t *item) {
+  if (item == NULL || item->name == NULL) {
+    fprintf(stderr, "Unable to dereference a NULL pointer\n");
+    return -1;
+  }
+
+  if (wait_retry(&s->empty) == -1) // block producer if no empty slots
+    return -1;
+  if (wait_retry(&s->mutex) == -1) { // acquire exclusive access
+    sem_post(&s->empty);
+    return -1;
+  }
+
+  // tail is tracked on its own: a consumer past sem_wait(full) but not yet
+  // holding the mutex has not advanced head, so head + full can land on an
+  // unconsumed slot
+  s->arr[s->tail] = *item;
+
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  s->arr[s->tail].enqueued = now.tv_sec * 1000000000LL + now.tv_nsec;
+  s->arr[s->tail].seq = s->puts++;
+  s->tail = (s->tail + 1) % ARRAY_SIZE; // modulo for circular behavior
+
+  sem_post(&s->mutex); // release access
+  sem_post(&s->full);  // signal that a slot has been filled
+
+  return 0;
+}
+
+int array_get(array *s, name_handle_t *item) {
+  if (item == NULL) {
+    fprintf(stderr, "Unable to dereference a NULL pointer\n");
+    return -1;
+  }
+
+  if (wait_retry(&s->full) == -1) // block consumer if no full slots
+    return -1;
+  if (wait_retry(&s->mutex) == -1) { // acquire exclusive access
+    sem_post(&s->full);
+    return -1;
+  }
+
+  *item = s->arr[s->head];
+  s->head = (s->head + 1) % ARRAY_SIZE;
+
+  sem_post(&s->mutex); // release access
+  sem_post(&s->empty); // signal that a slot has been emptied
+
+  return 0;
+}
+
+int array_try_get(array *s, name_handle_t *item) {
+  if (item == NULL) {
+    fprintf(stderr, "Unable to dereference a NULL pointer\n");
+    return -1;
+  }
+
+  if (sem_trywait(&s->full) == -1) // nothing queued right now
+    return 1;
+  if (wait_retry(&s->mutex) == -1) { // acquire exclusive access
+    sem_post(&s->full);
+    return -1;
+  }
+
+  *item = s->arr[s->head];
+  s->head = (s->head + 1) % ARRAY_SIZE;
+
+  sem_post(&s->mutex); // release access
+  sem_post(&s->empty); // signal that a slot has been emptied
+
+  return 0;
+}
+
+void array_free(array *s) {
+  sem_wait(&s->mutex);
+  // names are owned by whoever produced them, only drop the handles
+  memset(s->arr, 0, sizeof(s->arr));
+
+  sem_post(&s->mutex); // release mutual exclusion
+  synchronize_free(s); // destroy synchronization mechanisms
+
+  return;
+}
+
+void synchronize_free(array *s) {
+  sem_destroy(&s->mutex);
+  sem_destroy(&s->full);
+  sem_destroy(&s->empty);
+
+  return;
+}
@@ -0,0 +1,51 @@
+#ifndef ARRAY_H
+#define ARRAY_H
+
+#include <semaphore.h>
+#include <stddef.h>
+
+#define ARRAY_SIZE 8 // max elements
+#define MAX_NAME_LENGTH                                                        \
+  254 // longest DNS name (253 per RFC 1035) + 1 slot for \0
+#define PSHARED 0 // 0 indicates sharing between threads of a process
+
+// handle to a name stored elsewhere (arena page, argv, ...)
+// the queue moves handles only, names are never copied through it
+typedef struct {
+  const char *name;   // \0 terminated, not owned by the queue
+  size_t len;         // strlen(name)
+  void *page;         // arena page backing name, NULL if not arena backed
+  void *owner;        // opaque context travelling with the entry
+  long long enqueued; // CLOCK_MONOTONIC ns, set by array_put
+  unsigned long long seq;   // items put before this one, set by array_put
+  unsigned long long order; // output position (-o), set by the requester
+} name_handle_t;
+
+// shared, circular FIFO array (PA4 bounded buffer, adapted for PA6)
+typedef struct {
+  name_handle_t arr[ARRAY_SIZE]; // queued handles
+  int head;                      // track first item - consume here
+  int tail;                      // track last item - produce here
+  unsigned long long puts;       // items ever put, numbers each one
+  sem_t mutex;                   // binary semaphore for mutual exclusion
+  sem_t full;                    // number of filled slots
+  sem_t empty;                   // number of empty slots
+} array;
+
+/* semaphore related */
+void synchronize_init(array *s);
+void synchronize_free(array *s);
+
+/* circular array related */
+int array_init(array *s);
+// copies the handle (not the name) into the next free slot and stamps
+// its enqueue time so consumers can measure queue residence, and its
+// sequence number (FIFO position)
+int array_put(array *s, const name_handle_t *item);
+// removes the oldest handle into *item
+int array_get(array *s, name_handle_t *item);
+// like array_get but returns 1 instead of blocking when the array is empty
+int array_try_get(array *s, name_handle_t *item);
+void array_free(array *s);
+
+#endif
@@ -0,0 +1,70 @@
+#!/bin/sh
+# Scaling benchmark for multi-lookup
+#
+# Runs multi-lookup over every data file in <dir> once per combination of
+# requester and resolver counts and prints one table row per run, taken
+# from the JSON run report. Generate inputs with workload-gen first (built
+# by make -f tools.mk workload-gen), e.g.
+#
+#   ./workload-gen -f 50 -n 2000 -u 0.3 -i 0.05 bench-input
+#   ./bench.sh bench-input
+#
+# Environment:
+#   REQUESTERS  space separated requester counts (default "1 2 5 10")
+#   RESOLVERS   space separated resolver counts  (default "1 2 5 10")
+#   REPEATS     runs per combination             (default 1)
+#   ML_FLAGS    extra multi-lookup flags, e.g. "-d" or "-c cache.db"
+
+set -e
+
+if [ $# -ne 1 ] || [ ! -d "$1" ]; then
+  echo "usage: $0 <input dir>" >&2
+  exit 1
+fi
+
+DIR=$1
+REQUESTERS=${REQUESTERS:-"1 2 5 10"}
+RESOLVERS=${RESOLVERS:-"1 2 5 10"}
+REPEATS=${REPEATS:-1}
+OUT=$(mktemp -d)
+trap 'rm -rf "$OUT"' EXIT
+
+# json_field <report> <stage or ""> <field>
+# report layout is one stage per line, see write_report / stats_write_json
+json_field() {
+  if [ -z "$2" ]; then
+    sed -n "s/^  \"$3\": \([0-9]*\).*/\1/p" "$1"
+  else
+    sed -n "s/.*\"$2\": {.*\"$3\": \([0-9]*\).*/\1/p" "$1"
+  fi
+}
+
+printf "%4s %4s %3s %8s %10s %12s %10s %10s %10s %10s\n" \
+  req res run hosts elapsed_s hosts_per_s lookup_p50 lookup_p99 \
+  resid_p99 write_p99
+for req in $REQUESTERS; do
+  for res in $RESOLVERS; do
+    run=1
+    while [ "$run" -le "$REPEATS" ]; do
+      # shellcheck disable=SC2086 # ML_FLAGS is meant to split
+      ./multi-lookup $ML_FLAGS "$req" "$res" "$OUT/serviced.txt" \
+        "$OUT/results.txt" "$DIR"/*.txt >/dev/null 2>&1
+      report="$OUT/results.txt.report.json"
+      hosts=$(json_field "$report" "" hosts)
+      elapsed=$(json_field "$report" "" elapsed_ns)
+      awk -v req="$req" -v res="$res" -v run="$run" -v hosts="$hosts" \
+        -v ns="$elapsed" \
+        -v lp50="$(json_field "$report" lookup p50_ns)" \
+        -v lp99="$(json_field "$report" lookup p99_ns)" \
+        -v rp99="$(json_field "$report" queue_residence p99_ns)" \
+        -v wp99="$(json_field "$report" output_write p99_ns)" \
+        'BEGIN {
+          s = ns / 1e9
+          printf "%4d %4d %3d %8d %10.3f %12.1f %8.1fus %8.1fus %8.1fus %8.1fus\n",
+            req, res, run, hosts, s, (s > 0 ? hosts / s : 0),
+            lp50 / 1e3, lp99 / 1e3, rp99 / 1e3, wp99 / 1e3
+        }'
+      run=$((run + 1))
+    done
+  done
+done
@@ -0,0 +1,240 @@
+#include "cache.h"
+#include "hash.h"
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+// 0 marks empty slots, so no real name may hash to it
+static uint64_t cache_hash(const char *name, size_t len) {
+  uint64_t h = hash_name(name, len);
+  return h == 0 ? 1 : h;
+}
+
+static size_t cache_map_len(uint64_t num_slots) {
+  return sizeof(cache_header_t) + num_slots * sizeof(cache_slot_t);
+}
+
+// fresh zeroed table, not backed by any file until close
+static int cache_map_empty(cache_t *cache, uint64_t num_slots) {
+  size_t len = cache_map_len(num_slots);
+  void *map = mmap(NULL, len, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (map == MAP_FAILED) {
+    perror("mmap");
+    return -1;
+  }
+
+  cache->map = map;
+  cache->map_len = len;
+  cache->header = map;
+  cache->slots = (cache_slot_t *)(cache->header + 1);
+  cache->header->magic = CACHE_MAGIC;
+  cache->header->version = CACHE_VERSION;
+  cache->header->num_slots = num_slots;
+  cache->header->num_used = 0;
+  cache->header->slot_size = sizeof(cache_slot_t);
+
+  return 0;
+}
+
+// map an existing cache file, returns -1 if it is missing or unusable
+static int cache_map_file(cache_t *cache, const char *path) {
+  int fd = open(path, O_RDONLY);
+  if (fd == -1)
+    return -1;
+
+  struct stat st;
+  cache_header_t header;
+  if (fstat(fd, &st) == -1 ||
+      pread(fd, &header, sizeof(header), 0) != sizeof(header) ||
+      header.magic != CACHE_MAGIC || header.version != CACHE_VERSION ||
+      header.slot_size != sizeof(cache_slot_t) || header.num_slots == 0 ||
+      (header.num_slots & (header.num_slots - 1)) != 0 ||
+      (size_t)st.st_size != cache_map_len(header.num_slots)) {
+    close(fd);
+    return -1;
+  }
+
+  // private: new entries stay in memory until cache_close writes them out
+  void *map = mmap(NULL, st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd,
+                   0);
+  close(fd);
+  if (map == MAP_FAILED)
+    return -1;
+
+  cache->map = map;
+  cache->map_len = st.st_size;
+  cache->header = map;
+  cache->slots = (cache_slot_t *)(cache->header + 1);
+
+  return 0;
+}
+
+// cache_persist writes a temp file next to path, so its directory must be
+// writable; checked up front so a bad -c fails before the job runs
+static int cache_dir_writable(const char *path) {
+  char dir[4096];
+  const char *slash = strrchr(path, '/');
+  if (slash == NULL)
+    return access(".", W_OK | X_OK) == 0;
+
+  size_t len = slash == path ? 1 : (size_t)(slash - path);
+  if (len >= sizeof(dir))
+    return 0;
+  memcpy(dir, path, len);
+  dir[len] = '\0';
+  return access(dir, W_OK | X_OK) == 0;
+}
+
+int cache_open(cache_t *cache, const char *path, long ttl) {
+  memset(cache, 0, sizeof(*cache));
+  if (!cache_dir_writable(path)) {
+    fprintf(stderr, "Cache cannot be written: %s\n", path);
+    return -1;
+  }
+  cache->path = path;
+  cache->ttl = ttl;
+  pthread_rwlock_init(&cache->lock, NULL);
+
+  if (cache_map_file(cache, path) == 0)
+    return 0;
+
+  return cache_map_empty(cache, CACHE_DEFAULT_SLOTS);
+}
+
+// slot holding name, or the empty slot where it belongs
+static cache_slot_t *cache_probe(cache_slot_t *slots, uint64_t num_slots,
+                                 uint64_t hash, const char *name) {
+  uint64_t mask = num_slots - 1;
+  for (uint64_t i = hash & mask;; i = (i + 1) & mask) {
+    cache_slot_t *slot = &slots[i];
+    if (slot->hash == 0)
+      return slot;
+    if (slot->hash == hash && strcmp(slot->name, name) == 0)
+      return slot;
+  }
+}
+
+int cache_lookup(cache_t *cache, const char *name, char *ip, size_t ip_len) {
+  size_t len = strlen(name);
+  if (len >= CACHE_NAME_LENGTH)
+    return 0;
+  uint64_t hash = cache_hash(name, len);
+
+  int hit = 0;
+  pthread_rwlock_rdlock(&cache->lock);
+  cache_slot_t *slot =
+      cache_probe(cache->slots, cache->header->num_slots, hash, name);
+  if (slot->hash != 0 && slot->expires > time(NULL)) {
+    strncpy(ip, slot->ip, ip_len - 1);
+    ip[ip_len - 1] = '\0';
+    hit = 1;
+  }
+  pthread_rwlock_unlock(&cache->lock);
+
+  return hit;
+}
+
+// double the table, dropping expired entries; caller holds the write lock
+static int cache_grow(cache_t *cache) {
+  cache_t bigger = *cache;
+  if (cache_map_empty(&bigger, cache->header->num_slots * 2) == -1)
+    return -1;
+
+  time_t now = time(NULL);
+  for (uint64_t i = 0; i < cache->header->num_slots; i++) {
+    cache_slot_t *old = &cache->slots[i];
+    if (old->hash == 0 || old->expires <= now)
+      continue;
+    *cache_probe(bigger.slots, bigger.header->num_slots, old->hash,
+                 old->name) = *old;
+    bigger.header->num_used++;
+  }
+
+  munmap(cache->map, cache->map_len);
+  cache->map = bigger.map;
+  cache->map_len = bigger.map_len;
+  cache->header = bigger.header;
+  cache->slots = bigger.slots;
+
+  return 0;
+}
+
+int cache_insert(cache_t *cache, const char *name, const char *ip) {
+  size_t len = strlen(name);
+  if (len >= CACHE_NAME_LENGTH)
+    return -1;
+  uint64_t hash = cache_hash(name, len);
+
+  int result = 0;
+  pthread_rwlock_wrlock(&cache->lock);
+  if ((cache->header->num_used + 1) * 100 >
+          cache->header->num_slots * CACHE_MAX_LOAD_PCT &&
+      cache_grow(cache) == -1) {
+    result = -1;
+  } else {
+    cache_slot_t *slot =
+        cache_probe(cache->slots, cache->header->num_slots, hash, name);
+    if (slot->hash == 0) {
+      cache->header->num_used++;
+      slot->hash = hash;
+      memset(slot->name, 0, sizeof(slot->name)); // keep the file reproducible
+      memcpy(slot->name, name, len);
+    }
+    memset(slot->ip, 0, sizeof(slot->ip));
+    strncpy(slot->ip, ip, sizeof(slot->ip) - 1);
+    slot->expires = time(NULL) + cache->ttl;
+    cache->dirty = 1;
+  }
+  pthread_rwlock_unlock(&cache->lock);
+
+  return result;
+}
+
+// write the whole table next to path, then atomically replace path
+static int cache_persist(cache_t *cache) {
+  char tmp[4096];
+  snprintf(tmp, sizeof(tmp), "%s.tmp.%d", cache->path, (int)getpid());
+
+  int fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd == -1) {
+    perror("open cache");
+    return -1;
+  }
+
+  const char *buf = cache->map;
+  for (size_t off = 0; off < cache->map_len;) {
+    ssize_t n = write(fd, buf + off, cache->map_len - off);
+    if (n <= 0) {
+      perror("write cache");
+      close(fd);
+      unlink(tmp);
+      return -1;
+    }
+    off += n;
+  }
+
+  if (fsync(fd) == -1 || close(fd) == -1 || rename(tmp, cache->path) == -1) {
+    perror("persist cache");
+    unlink(tmp);
+    return -1;
+  }
+
+  return 0;
+}
+
+int cache_close(cache_t *cache) {
+  int result = 0;
+  if (cache->dirty)
+    result = cache_persist(cache);
+
+  munmap(cache->map, cache->map_len);
+  cache->map = NULL;
+  pthread_rwlock_destroy(&cache->lock);
+
+  return result;
+}
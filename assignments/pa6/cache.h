@@ -0,0 +1,61 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <netinet/in.h> // for INET6_ADDRSTRLEN
+#include <pthread.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define CACHE_MAGIC 0x50434c4dU // "MLCP"
+#define CACHE_VERSION 1
+#define CACHE_NAME_LENGTH 256 // longest DNS name (253) + \0, rounded up
+#define CACHE_DEFAULT_SLOTS (1 << 12)
+#define CACHE_DEFAULT_TTL 3600 // seconds a cached address stays valid
+#define CACHE_MAX_LOAD_PCT 75  // grow once the table is this full
+
+// on-disk layout: header followed by num_slots slots, all fixed size, so the
+// file is used in place after mmap without any parsing step
+typedef struct {
+  uint32_t magic;
+  uint32_t version;
+  uint64_t num_slots; // power of two
+  uint64_t num_used;
+  uint64_t slot_size; // sizeof(cache_slot_t) when written, layout check
+} cache_header_t;
+
+typedef struct {
+  uint64_t hash;    // 0 marks an empty slot
+  int64_t expires;  // wall clock seconds (time()) after which slot is stale
+  char ip[INET6_ADDRSTRLEN];
+  char name[CACHE_NAME_LENGTH];
+} cache_slot_t;
+
+// open-addressing (linear probe) table of hostname -> address
+typedef struct {
+  const char *path;
+  void *map; // header + slots, private copy-on-write mapping of the file
+  size_t map_len;
+  cache_header_t *header;
+  cache_slot_t *slots;
+  long ttl;
+  int dirty; // something was inserted since open
+  pthread_rwlock_t lock;
+} cache_t;
+
+/* Maps the cache file at path
+** A missing or incompatible file starts an empty table instead, startup
+** cost does not depend on how many entries the file holds
+** Fails if the table could not be written back to path at close
+*/
+int cache_open(cache_t *cache, const char *path, long ttl);
+
+// copies the cached address for name into ip, returns 1 on hit, 0 on miss
+int cache_lookup(cache_t *cache, const char *name, char *ip, size_t ip_len);
+int cache_insert(cache_t *cache, const char *name, const char *ip);
+
+/* Writes the table back (temp file + rename, so readers never see a
+** partial file) if anything changed, then unmaps it
+*/
+int cache_close(cache_t *cache);
+
+#endif
@@ -0,0 +1,343 @@
+#define _GNU_SOURCE // ppoll, memrchr
+#include "daemon.h"
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// one client being read by the serve loop
+typedef struct {
+  client_t *client;
+  size_t len;   // bytes in buf, only ever part of a line between reads
+  int skipping; // dropping the rest of a line longer than buf
+  char buf[CLIENT_BUFFER_SIZE];
+} conn_t;
+
+static volatile sig_atomic_t stopping = 0;
+
+static void handle_stop(int sig) {
+  (void)sig;
+  stopping = 1;
+}
+
+client_t *client_open(int in_fd, int out_fd) {
+  client_t *client = malloc(sizeof(client_t));
+  if (client == NULL) {
+    fprintf(stderr, "Error allocating memory for client\n");
+    return NULL;
+  }
+
+  client->in_fd = in_fd;
+  client->out_fd = out_fd;
+  client->refs = 1; // held by whoever reads the client
+  pthread_mutex_init(&client->lock, NULL);
+
+  return client;
+}
+
+void client_ref(client_t *client) {
+  pthread_mutex_lock(&client->lock);
+  client->refs++;
+  pthread_mutex_unlock(&client->lock);
+}
+
+void client_unref(client_t *client) {
+  pthread_mutex_lock(&client->lock);
+  int refs = --client->refs;
+  pthread_mutex_unlock(&client->lock);
+
+  if (refs > 0)
+    return;
+
+  // stdin / stdout belong to the process, sockets belong to the client
+  if (client->in_fd != STDIN_FILENO)
+    close(client->in_fd);
+  if (client->out_fd != client->in_fd && client->out_fd != STDOUT_FILENO)
+    close(client->out_fd);
+
+  pthread_mutex_destroy(&client->lock);
+  free(client);
+}
+
+int client_reply(client_t *client, const char *host, const char *ip) {
+  char line[512];
+  int len = snprintf(line, sizeof(line), "%s, %s\n", host, ip);
+  if (len < 0 || len >= (int)sizeof(line))
+    return -1;
+
+  int result = 0;
+  pthread_mutex_lock(&client->lock);
+  for (int off = 0; off < len;) {
+    ssize_t n = write(client->out_fd, line + off, len - off);
+    if (n < 0) {
+      if (errno == EINTR)
+        continue;
+      result = -1; // client went away, nothing left to answer
+      break;
+    }
+    off += n;
+  }
+  pthread_mutex_unlock(&client->lock);
+
+  return result;
+}
+
+// hand the whole lines buf[0, len) of a client to the requester pool
+static int enqueue_lines(array *file_store, client_t *client, const char *buf,
+                         size_t len) {
+  char *lines = malloc(len + 1);
+  if (lines == NULL) {
+    fprintf(stderr, "Error allocating memory for client\n");
+    return -1;
+  }
+  memcpy(lines, buf, len);
+  lines[len] = '\0';
+
+  name_handle_t entry;
+  memset(&entry, 0, sizeof(entry));
+  entry.name = lines;
+  entry.len = len;
+  entry.owner = client;
+
+  // the lines hold their client open until a requester has submitted them
+  client_ref(client);
+  if (array_put(file_store, &entry) == -1) {
+    client_unref(client);
+    free(lines);
+    return -1;
+  }
+
+  return 0;
+}
+
+/* Reads what a client has sent and queues its complete lines
+** Returns 1 once the client has hung up (its last line is queued even
+** without a newline) or cannot be read any more, 0 otherwise
+*/
+static int conn_read(conn_t *conn, array *file_store) {
+  ssize_t n = read(conn->client->in_fd, conn->buf + conn->len,
+                   sizeof(conn->buf) - conn->len);
+  if (n < 0)
+    return errno == EINTR || errno == EAGAIN ? 0 : 1;
+  if (n == 0) {
+    if (conn->len > 0 && !conn->skipping)
+      enqueue_lines(file_store, conn->client, conn->buf, conn->len);
+    return 1;
+  }
+  conn->len += n;
+
+  if (conn->skipping) {
+    char *newline = memchr(conn->buf, '\n', conn->len);
+    if (newline == NULL) {
+      conn->len = 0;
+      return 0;
+    }
+    conn->skipping = 0;
+    conn->len -= newline + 1 - conn->buf;
+    memmove(conn->buf, newline + 1, conn->len);
+  }
+
+  char *last = memrchr(conn->buf, '\n', conn->len);
+  if (last == NULL) {
+    // a whole buffer without a newline is no hostname
+    if (conn->len == sizeof(conn->buf)) {
+      fprintf(stderr, "Hostname too long, skipped: %.32s...\n", conn->buf);
+      conn->skipping = 1;
+      conn->len = 0;
+    }
+    return 0;
+  }
+
+  size_t whole = last + 1 - conn->buf;
+  if (enqueue_lines(file_store, conn->client, conn->buf, whole) == -1)
+    return 1;
+  conn->len -= whole;
+  memmove(conn->buf, last + 1, conn->len);
+
+  return 0;
+}
+
+static conn_t *conn_open(int in_fd, int out_fd) {
+  conn_t *conn = malloc(sizeof(conn_t));
+  if (conn == NULL) {
+    fprintf(stderr, "Error allocating memory for client\n");
+    return NULL;
+  }
+
+  conn->client = client_open(in_fd, out_fd);
+  if (conn->client == NULL) {
+    free(conn);
+    return NULL;
+  }
+  conn->len = 0;
+  conn->skipping = 0;
+
+  return conn;
+}
+
+// stop reading; the client stays open until its queued names are answered
+static void conn_close(conn_t *conn) {
+  client_unref(conn->client);
+  free(conn);
+}
+
+static int listen_socket(const char *path) {
+  struct sockaddr_un addr;
+  if (strlen(path) >= sizeof(addr.sun_path)) {
+    fprintf(stderr, "Socket path too long: %s\n", path);
+    return -1;
+  }
+
+  int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (listen_fd == -1) {
+    perror("socket");
+    return -1;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+
+  unlink(path); // stale socket from a previous run
+  if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) == -1 ||
+      listen(listen_fd, LISTEN_BACKLOG) == -1) {
+    perror("bind/listen");
+    close(listen_fd);
+    return -1;
+  }
+
+  return listen_fd;
+}
+
+int serve(const char *path, array *file_store) {
+  // a client that disconnects early must not kill the daemon
+  signal(SIGPIPE, SIG_IGN);
+
+  // no SA_RESTART so ppoll returns EINTR once a stop signal arrives
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = handle_stop;
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGINT, &sa, NULL);
+  sigaction(SIGTERM, &sa, NULL);
+
+  // main keeps the stop signals blocked like the worker threads and takes
+  // them only inside ppoll, so one arriving between two polls is not lost
+  sigset_t wait_mask;
+  pthread_sigmask(SIG_BLOCK, NULL, &wait_mask);
+  sigdelset(&wait_mask, SIGINT);
+  sigdelset(&wait_mask, SIGTERM);
+
+  int stream = strcmp(path, STDIN_STREAM) == 0;
+  int listen_fd = -1;
+  if (!stream && (listen_fd = listen_socket(path)) == -1)
+    return -1;
+
+  // clients, and poll entries for them plus the listening socket
+  int capacity = CLIENTS_INITIAL;
+  conn_t **conns = malloc(capacity * sizeof(conn_t *));
+  struct pollfd *fds = malloc((capacity + 1) * sizeof(struct pollfd));
+  int num_conns = 0;
+  int result = 0;
+
+  if (conns == NULL || fds == NULL) {
+    fprintf(stderr, "Error allocating memory for client\n");
+    result = -1;
+    goto done;
+  }
+
+  // single stream, ends at EOF like a data file would
+  if (stream) {
+    if ((conns[0] = conn_open(STDIN_FILENO, STDOUT_FILENO)) == NULL) {
+      result = -1;
+      goto done;
+    }
+    num_conns = 1;
+  }
+
+  while (!stopping && (listen_fd != -1 || num_conns > 0)) {
+    // the listening socket first, then every client in conns order
+    int nfds = 0;
+    if (listen_fd != -1) {
+      fds[nfds].fd = listen_fd;
+      fds[nfds++].events = POLLIN;
+    }
+    int first = nfds;
+    for (int i = 0; i < num_conns; i++) {
+      fds[nfds].fd = conns[i]->client->in_fd;
+      fds[nfds++].events = POLLIN;
+    }
+
+    if (ppoll(fds, nfds, NULL, &wait_mask) == -1) {
+      if (errno == EINTR)
+        continue; // woken by SIGINT / SIGTERM, loop re-checks stopping
+      perror("poll");
+      result = -1;
+      break;
+    }
+
+    // closing moves the last client into the gap, so walk backwards
+    for (int i = num_conns - 1; i >= 0; i--) {
+      if (fds[first + i].revents == 0)
+        continue;
+      if (conn_read(conns[i], file_store)) {
+        conn_close(conns[i]);
+        conns[i] = conns[--num_conns];
+      }
+    }
+
+    if (listen_fd == -1 || !(fds[0].revents & POLLIN))
+      continue;
+
+    int fd = accept(listen_fd, NULL, NULL);
+    if (fd == -1) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      perror("accept");
+      result = -1;
+      break;
+    }
+
+    // room for one more client, plus the listening socket
+    if (num_conns == capacity) {
+      int grown = capacity * 2;
+      conn_t **more_conns = realloc(conns, grown * sizeof(conn_t *));
+      if (more_conns != NULL)
+        conns = more_conns;
+      struct pollfd *more_fds = realloc(fds, (grown + 1) * sizeof(struct pollfd));
+      if (more_fds != NULL)
+        fds = more_fds;
+      if (more_conns == NULL || more_fds == NULL) {
+        fprintf(stderr, "Error allocating memory for client\n");
+        close(fd);
+        continue;
+      }
+      capacity = grown;
+    }
+    if ((conns[num_conns] = conn_open(fd, fd)) == NULL) {
+      close(fd);
+      continue;
+    }
+    num_conns++;
+  }
+
+done:
+  // names already queued are still answered
+  for (int i = 0; i < num_conns; i++) {
+    conn_close(conns[i]);
+  }
+  free(conns);
+  free(fds);
+
+  if (listen_fd != -1) {
+    close(listen_fd);
+    unlink(path);
+  }
+
+  return result;
+}
@@ -0,0 +1,43 @@
+#ifndef DAEMON_H
+#define DAEMON_H
+
+#include "array.h"
+#include <pthread.h>
+
+#define LISTEN_BACKLOG 64
+#define STDIN_STREAM "-" // -S - serves stdin/stdout instead of a socket
+#define CLIENT_BUFFER_SIZE (16 * 1024) // bytes read from a client at a time
+#define CLIENTS_INITIAL 16 // clients the serve loop has room for at first
+
+// one connected client (or the stdin/stdout stream)
+// referenced by the serve loop while it reads the client, by every chunk of
+// lines queued for the requesters and by every hostname it sent that has not
+// been answered yet
+typedef struct client {
+  int in_fd;
+  int out_fd;
+  int refs;
+  pthread_mutex_t lock; // serializes replies and guards refs
+} client_t;
+
+client_t *client_open(int in_fd, int out_fd);
+void client_ref(client_t *client);
+// drops one reference, closing and freeing the client on the last one
+void client_unref(client_t *client);
+
+// writes "host, ip\n" back to the client
+int client_reply(client_t *client, const char *host, const char *ip);
+
+/* Serves lookups until SIGINT / SIGTERM
+** Functionality:
+** - Listens on the Unix domain socket at path (or reads stdin until EOF
+**   when path is "-")
+** - Reads every client in one poll loop and hands whole lines to the
+**   requester pool through file_store, as a malloc'd chunk whose owner is
+**   the client; a requester submits the chunk, frees it and drops its
+**   reference, so no requester ever waits on a connection
+** - On shutdown, stops reading from open clients so requesters drain
+*/
+int serve(const char *path, array *file_store);
+
+#endif
@@ -0,0 +1,106 @@
+#include "dedup.h"
+#include "hash.h"
+#include <stdlib.h>
+#include <string.h>
+
+int dedup_init(dedup_set_t *set, size_t num_buckets) {
+  set->buckets = calloc(num_buckets, sizeof(dedup_entry_t *));
+  if (set->buckets == NULL) {
+    fprintf(stderr, "Failed to allocate memory\n");
+    return -1;
+  }
+  set->num_buckets = num_buckets;
+
+  for (int i = 0; i < DEDUP_STRIPES; i++) {
+    pthread_mutex_init(&set->locks[i], NULL);
+  }
+
+  return 0;
+}
+
+void dedup_free(dedup_set_t *set) {
+  for (size_t i = 0; i < set->num_buckets; i++) {
+    dedup_entry_t *entry = set->buckets[i];
+    while (entry != NULL) {
+      dedup_entry_t *next = entry->next;
+      free(entry);
+      entry = next;
+    }
+  }
+  free(set->buckets);
+  set->buckets = NULL;
+
+  for (int i = 0; i < DEDUP_STRIPES; i++) {
+    pthread_mutex_destroy(&set->locks[i]);
+  }
+}
+
+// caller must hold the stripe lock for bucket
+static dedup_entry_t *dedup_find(dedup_set_t *set, size_t bucket,
+                                 unsigned long long hash, const char *name) {
+  for (dedup_entry_t *entry = set->buckets[bucket]; entry != NULL;
+       entry = entry->next) {
+    if (entry->hash == hash && strcmp(entry->name, name) == 0)
+      return entry;
+  }
+  return NULL;
+}
+
+int dedup_insert(dedup_set_t *set, const char *name) {
+  size_t len = strlen(name);
+  unsigned long long hash = hash_name(name, len);
+  size_t bucket = hash % set->num_buckets;
+  pthread_mutex_t *lock = &set->locks[bucket % DEDUP_STRIPES];
+
+  int result;
+  pthread_mutex_lock(lock);
+  dedup_entry_t *entry = dedup_find(set, bucket, hash, name);
+  if (entry != NULL) {
+    entry->count++;
+    result = 0;
+  } else {
+    entry = malloc(sizeof(dedup_entry_t) + len + 1);
+    if (entry == NULL) {
+      result = -1;
+    } else {
+      entry->hash = hash;
+      entry->count = 1;
+      entry->ip[0] = '\0';
+      memcpy(entry->name, name, len + 1);
+      entry->next = set->buckets[bucket];
+      set->buckets[bucket] = entry;
+      result = 1;
+    }
+  }
+  pthread_mutex_unlock(lock);
+
+  return result;
+}
+
+void dedup_set_result(dedup_set_t *set, const char *name, const char *ip) {
+  unsigned long long hash = hash_name(name, strlen(name));
+  size_t bucket = hash % set->num_buckets;
+  pthread_mutex_t *lock = &set->locks[bucket % DEDUP_STRIPES];
+
+  pthread_mutex_lock(lock);
+  dedup_entry_t *entry = dedup_find(set, bucket, hash, name);
+  if (entry != NULL) {
+    strncpy(entry->ip, ip, sizeof(entry->ip) - 1);
+    entry->ip[sizeof(entry->ip) - 1] = '\0';
+  }
+  pthread_mutex_unlock(lock);
+}
+
+long dedup_write_duplicates(dedup_set_t *set, result_writer_t *out) {
+  long written = 0;
+  for (size_t i = 0; i < set->num_buckets; i++) {
+    for (dedup_entry_t *entry = set->buckets[i]; entry != NULL;
+         entry = entry->next) {
+      for (int n = 1; n < entry->count; n++) {
+        result_write(out, entry->name, entry->ip);
+        written++;
+      }
+    }
+  }
+  return written;
+}
@@ -0,0 +1,48 @@
+#ifndef DEDUP_H
+#define DEDUP_H
+
+#include "results.h"
+#include <netinet/in.h> // for INET6_ADDRSTRLEN
+#include <pthread.h>
+#include <stdio.h>
+
+#define DEDUP_BUCKETS (1 << 16) // chained buckets, fixed for the run
+#define DEDUP_STRIPES 64        // bucket i is guarded by lock i % STRIPES
+
+// one unique hostname seen by the requesters
+typedef struct dedup_entry {
+  struct dedup_entry *next;
+  unsigned long long hash;
+  int count;                  // occurrences seen across all input files
+  char ip[INET6_ADDRSTRLEN];  // result, filled in by the resolver (expand)
+  char name[];
+} dedup_entry_t;
+
+// concurrent hash set checked by requesters before array_put
+typedef struct {
+  dedup_entry_t **buckets;
+  size_t num_buckets;
+  pthread_mutex_t locks[DEDUP_STRIPES];
+} dedup_set_t;
+
+int dedup_init(dedup_set_t *set, size_t num_buckets);
+void dedup_free(dedup_set_t *set);
+
+/* Records one occurrence of name
+** Returns:
+** - 1 if this is the first occurrence (caller should enqueue it)
+** - 0 if the name was already seen
+** - -1 on allocation failure
+*/
+int dedup_insert(dedup_set_t *set, const char *name);
+
+// stores the resolved address so duplicates can be expanded at exit
+void dedup_set_result(dedup_set_t *set, const char *name, const char *ip);
+
+/* Writes the result once for every occurrence beyond the first
+** Only meaningful once all resolvers have been joined
+** Returns the number of results written
+*/
+long dedup_write_duplicates(dedup_set_t *set, result_writer_t *out);
+
+#endif
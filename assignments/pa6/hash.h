@@ -0,0 +1,28 @@
+#ifndef HASH_H
+#define HASH_H
+
+#include <stddef.h>
+
+// 64-bit FNV-1a over len bytes of name
+// shared by the hostname tables so every stage agrees on a name's hash
+static inline unsigned long long hash_name(const char *name, size_t len) {
+  unsigned long long h = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)name[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+// hash_name of the lowercased name, for tables whose names are lowercase
+static inline unsigned long long hash_name_lower(const char *name, size_t len) {
+  unsigned long long h = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; i++) {
+    unsigned char c = (unsigned char)name[i];
+    h ^= c >= 'A' && c <= 'Z' ? c + ('a' - 'A') : c;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+#endif
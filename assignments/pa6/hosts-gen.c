@@ -0,0 +1,67 @@
+/* Compiles a hosts file into static-hosts.h
+**
+** Builds the same minimal perfect hash multi-lookup builds for -H and writes
+** it out as static const tables, so building multi-lookup with
+** -DSTATIC_HOSTS answers those names without reading any file at startup.
+*/
+#include "hosts.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+const char *usage = "usage: hosts-gen <hosts file> > static-hosts.h\n";
+
+// C string literal, escaping what a hosts file token could contain
+static void print_string(const char *s) {
+  putchar('"');
+  for (; *s; s++) {
+    if (*s == '"' || *s == '\\')
+      putchar('\\');
+    putchar(*s);
+  }
+  putchar('"');
+}
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    fprintf(stderr, "%s", usage);
+    return EXIT_FAILURE;
+  }
+
+  hosts_table_t table;
+  if (hosts_load(&table, argv[1]) == -1)
+    return EXIT_FAILURE;
+  if (table.num_entries == 0) {
+    fprintf(stderr, "No hosts in %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  printf("/* Generated by hosts-gen from %s, do not edit */\n", argv[1]);
+  printf("#ifndef STATIC_HOSTS_H\n#define STATIC_HOSTS_H\n\n");
+  printf("#include \"hosts.h\"\n\n");
+
+  printf("static const uint32_t static_hosts_disp[%u] = {", table.num_buckets);
+  for (uint32_t b = 0; b < table.num_buckets; b++) {
+    printf("%s%s%u", b ? "," : "", b % 12 ? " " : "\n    ", table.disp[b]);
+  }
+  printf("};\n\n");
+
+  printf("static const hosts_entry_t static_hosts_entries[%u] = {\n",
+         table.num_entries);
+  for (uint32_t i = 0; i < table.num_entries; i++) {
+    const hosts_entry_t *entry = &table.entries[i];
+    printf("    {0x%016llxULL, ", entry->hash);
+    print_string(entry->name);
+    printf(", ");
+    print_string(entry->ip);
+    printf("},\n");
+  }
+  printf("};\n\n");
+
+  printf("static const hosts_table_t static_hosts = {\n"
+         "    static_hosts_disp, static_hosts_entries, %u, %u};\n\n",
+         table.num_buckets, table.num_entries);
+  printf("#endif\n");
+
+  hosts_free(&table);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,246 @@
+#include "hosts.h"
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef STATIC_HOSTS
+#include "static-hosts.h" // generated by hosts-gen
+#endif
+
+// a name read from the hosts file, before the table is built
+typedef struct {
+  unsigned long long hash;
+  char *name;
+  char ip[INET6_ADDRSTRLEN];
+  long line; // earliest line wins for a repeated name
+} hosts_key_t;
+
+static int compare_keys(const void *a, const void *b) {
+  const hosts_key_t *ka = a, *kb = b;
+  if (ka->hash != kb->hash)
+    return ka->hash < kb->hash ? -1 : 1;
+  int cmp = strcmp(ka->name, kb->name);
+  if (cmp != 0)
+    return cmp;
+  return ka->line < kb->line ? -1 : ka->line > kb->line;
+}
+
+static int add_key(hosts_key_t **keys, size_t *count, size_t *cap,
+                   const char *name, const char *ip, long line) {
+  if (*count == *cap) {
+    size_t new_cap = *cap ? *cap * 2 : 256;
+    hosts_key_t *grown = realloc(*keys, new_cap * sizeof(hosts_key_t));
+    if (grown == NULL)
+      return -1;
+    *keys = grown;
+    *cap = new_cap;
+  }
+
+  hosts_key_t *key = &(*keys)[*count];
+  key->name = strdup(name);
+  if (key->name == NULL)
+    return -1;
+  for (char *c = key->name; *c; c++)
+    *c = tolower((unsigned char)*c);
+  key->hash = hash_name(key->name, strlen(key->name));
+  strncpy(key->ip, ip, INET6_ADDRSTRLEN);
+  key->ip[INET6_ADDRSTRLEN - 1] = '\0';
+  key->line = line;
+  (*count)++;
+
+  return 0;
+}
+
+static int read_keys(const char *path, hosts_key_t **keys, size_t *count) {
+  FILE *in = fopen(path, "r");
+  if (in == NULL) {
+    fprintf(stderr, "Invalid file: %s\n", path);
+    return -1;
+  }
+
+  size_t cap = 0;
+  char *line = NULL;
+  size_t line_cap = 0;
+  long line_no = 0;
+  int result = 0;
+  unsigned char addr[sizeof(struct in6_addr)];
+
+  while (result == 0 && getline(&line, &line_cap, in) != -1) {
+    line_no++;
+    line[strcspn(line, "#")] = '\0';
+
+    char *save;
+    char *ip = strtok_r(line, " \t\r\n", &save);
+    if (ip == NULL)
+      continue; // blank or comment
+    if (inet_pton(AF_INET, ip, addr) != 1 &&
+        inet_pton(AF_INET6, ip, addr) != 1) {
+      fprintf(stderr, "Invalid address on line %ld of %s\n", line_no, path);
+      continue;
+    }
+
+    char *name;
+    while (result == 0 && (name = strtok_r(NULL, " \t\r\n", &save)) != NULL) {
+      result = add_key(keys, count, &cap, name, ip, line_no);
+    }
+  }
+
+  if (result == -1)
+    fprintf(stderr, "Failed to allocate memory\n");
+  free(line);
+  fclose(in);
+  return result;
+}
+
+/* Hash and displace: buckets are placed largest first, each trying
+** displacements until all of its names land on free entries
+*/
+static int build(hosts_table_t *table, hosts_key_t *keys, size_t n) {
+  uint32_t num_buckets = n / HOSTS_BUCKET_LOAD ? n / HOSTS_BUCKET_LOAD : 1;
+  uint32_t *disp = calloc(num_buckets, sizeof(uint32_t));
+  hosts_entry_t *entries = calloc(n, sizeof(hosts_entry_t));
+  uint32_t *start = calloc(num_buckets + 1, sizeof(uint32_t));
+  size_t *members = malloc(n * sizeof(size_t));
+  unsigned char *taken = calloc(n, 1);
+  uint32_t *slots = malloc(n * sizeof(uint32_t));
+  int result = 0;
+
+  if (disp == NULL || entries == NULL || start == NULL || members == NULL ||
+      taken == NULL || slots == NULL) {
+    fprintf(stderr, "Failed to allocate memory\n");
+    result = -1;
+    goto out;
+  }
+
+  // group names by bucket
+  uint32_t max_size = 0;
+  for (size_t i = 0; i < n; i++)
+    start[keys[i].hash % num_buckets + 1]++;
+  for (uint32_t b = 0; b < num_buckets; b++) {
+    if (start[b + 1] > max_size)
+      max_size = start[b + 1];
+    start[b + 1] += start[b];
+  }
+  for (size_t i = 0; i < n; i++) {
+    uint32_t b = keys[i].hash % num_buckets;
+    members[start[b]++] = i;
+  }
+  for (uint32_t b = num_buckets; b > 0; b--)
+    start[b] = start[b - 1];
+  start[0] = 0;
+
+  for (uint32_t size = max_size; size > 0 && result == 0; size--) {
+    for (uint32_t b = 0; b < num_buckets && result == 0; b++) {
+      if (start[b + 1] - start[b] != size)
+        continue;
+
+      uint32_t d;
+      for (d = 0; d < HOSTS_MAX_DISP; d++) {
+        uint32_t placed = 0;
+        for (; placed < size; placed++) {
+          unsigned long long h = keys[members[start[b] + placed]].hash;
+          uint32_t s = hosts_slot(h, d, n);
+          if (taken[s])
+            break;
+          uint32_t j = 0;
+          while (j < placed && slots[j] != s)
+            j++;
+          if (j < placed)
+            break; // two names of this bucket collide
+          slots[placed] = s;
+        }
+        if (placed == size)
+          break;
+      }
+      if (d == HOSTS_MAX_DISP) {
+        fprintf(stderr, "Unable to build a perfect hash for the hosts\n");
+        result = -1;
+        break;
+      }
+
+      disp[b] = d;
+      for (uint32_t j = 0; j < size; j++) {
+        hosts_key_t *key = &keys[members[start[b] + j]];
+        hosts_entry_t *entry = &entries[slots[j]];
+        taken[slots[j]] = 1;
+        entry->hash = key->hash;
+        entry->name = key->name;
+        memcpy(entry->ip, key->ip, INET6_ADDRSTRLEN);
+        key->name = NULL; // owned by the entry now
+      }
+    }
+  }
+
+out:
+  free(start);
+  free(members);
+  free(taken);
+  free(slots);
+  if (result == -1) {
+    for (size_t i = 0; entries != NULL && i < n; i++)
+      free((char *)entries[i].name);
+    free(entries);
+    free(disp);
+    return -1;
+  }
+
+  table->disp = disp;
+  table->entries = entries;
+  table->num_buckets = num_buckets;
+  table->num_entries = n;
+  return 0;
+}
+
+int hosts_load(hosts_table_t *table, const char *path) {
+  memset(table, 0, sizeof(*table));
+
+  hosts_key_t *keys = NULL;
+  size_t count = 0;
+  int result = read_keys(path, &keys, &count);
+
+  // a name listed twice keeps its first address
+  size_t unique = 0;
+  if (result == 0 && count > 0) {
+    qsort(keys, count, sizeof(hosts_key_t), compare_keys);
+    for (size_t i = 0; i < count; i++) {
+      if (unique > 0 && keys[unique - 1].hash == keys[i].hash) {
+        if (strcmp(keys[unique - 1].name, keys[i].name) != 0) {
+          fprintf(stderr, "Hash collision between %s and %s\n",
+                  keys[unique - 1].name, keys[i].name);
+          result = -1;
+        }
+        free(keys[i].name);
+        continue;
+      }
+      keys[unique++] = keys[i];
+    }
+  } else {
+    unique = count;
+  }
+
+  if (result == 0 && unique > 0)
+    result = build(table, keys, unique);
+
+  for (size_t i = 0; i < unique; i++)
+    free(keys[i].name); // NULL unless the build failed
+  free(keys);
+
+  return result;
+}
+
+void hosts_free(hosts_table_t *table) {
+  for (uint32_t i = 0; i < table->num_entries; i++)
+    free((char *)table->entries[i].name);
+  free((hosts_entry_t *)table->entries);
+  free((uint32_t *)table->disp);
+  memset(table, 0, sizeof(*table));
+}
+
+const hosts_table_t *hosts_builtin(void) {
+#ifdef STATIC_HOSTS
+  return &static_hosts;
+#else
+  return NULL;
+#endif
+}
@@ -0,0 +1,72 @@
+#ifndef HOSTS_H
+#define HOSTS_H
+
+#include "hash.h"
+#include <netinet/in.h> // for INET6_ADDRSTRLEN
+#include <stdint.h>
+#include <string.h>
+#include <strings.h> // for strcasecmp
+
+#define HOSTS_BUCKET_LOAD 4          // average names per displacement bucket
+#define HOSTS_MAX_DISP (1U << 24)    // give up on a bucket after this many tries
+
+// one static name and the address it always resolves to
+typedef struct {
+  unsigned long long hash; // hash_name(name), checked before the strcmp
+  const char *name;        // lowercase
+  char ip[INET6_ADDRSTRLEN];
+} hosts_entry_t;
+
+/* Static hosts table indexed by a minimal perfect hash (hash and displace)
+** Every name maps to its own entry through its bucket's displacement, so a
+** lookup reads one displacement and one entry. The same layout is emitted
+** by hosts-gen as static const tables, so a table can also be compiled in
+*/
+typedef struct {
+  const uint32_t *disp;          // per-bucket displacement
+  const hosts_entry_t *entries;  // num_entries, one per name
+  uint32_t num_buckets;
+  uint32_t num_entries;
+} hosts_table_t;
+
+// entry index for hash h under displacement d (splitmix64 finalizer)
+static inline uint32_t hosts_slot(unsigned long long h, uint32_t d,
+                                  uint32_t n) {
+  unsigned long long x = h ^ ((unsigned long long)d * 0x9e3779b97f4a7c15ULL);
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return (uint32_t)(x % n);
+}
+
+// address for name if it is in the table, NULL otherwise; case is ignored,
+// as the table's names were lowercased when it was built
+static inline const char *hosts_lookup(const hosts_table_t *table,
+                                       const char *name, size_t len) {
+  if (table->num_entries == 0)
+    return NULL;
+
+  unsigned long long h = hash_name_lower(name, len);
+  uint32_t d = table->disp[h % table->num_buckets];
+  const hosts_entry_t *entry =
+      &table->entries[hosts_slot(h, d, table->num_entries)];
+  if (entry->hash != h || strcasecmp(entry->name, name) != 0)
+    return NULL;
+  return entry->ip;
+}
+
+/* Loads a hosts file ("address name [alias ...]" lines, # comments, as in
+** /etc/hosts) and builds its perfect hash; names are lowercased and the
+** first address given for a name wins
+** Returns -1 (after printing why) if the file cannot be used
+*/
+int hosts_load(hosts_table_t *table, const char *path);
+void hosts_free(hosts_table_t *table);
+
+/* Table compiled in from static-hosts.h, NULL when built without one
+** To compile one in: make -f tools.mk hosts-gen, then
+** ./hosts-gen <hosts file> > static-hosts.h and build with -DSTATIC_HOSTS
+*/
+const hosts_table_t *hosts_builtin(void);
+
+#endif
@@ -0,0 +1,187 @@
+#define _GNU_SOURCE // getaddrinfo_a
+#include "lookup.h"
+#include "stats.h"
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netdb.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+typedef enum {
+  TASK_FETCH, // idle, waiting for the next hostname
+  TASK_QUERY, // query issued, suspended until it completes
+} task_state_t;
+
+struct lookup_task {
+  task_state_t state;
+  int finished; // set by the completion notification
+  name_handle_t host;
+  struct gaicb req;
+  long long started;
+  sem_t *wake; // the owning loop's
+};
+
+/* Completion notification, runs on a glibc helper thread
+** gai_suspend is not used: in glibc 2.36 it corrupts the heap when queries
+** finish while it waits. glibc also sets the request's result before it
+** drops the request from its queue, so gai_error alone cannot tell when a
+** gaicb may be reused; the notification is sent under the same lock as the
+** removal, so a task is reused only after its notification has arrived
+*/
+static void lookup_done(union sigval value) {
+  lookup_task_t *task = value.sival_ptr;
+  sem_t *wake = task->wake; // task may be reused once finished is seen
+  __atomic_store_n(&task->finished, 1, __ATOMIC_RELEASE);
+  sem_post(wake);
+}
+
+// same answer dnslookup gives: the first result, IPv4 only
+static int format_first(const struct addrinfo *head, char *ip, int size) {
+  char ipstr[INET6_ADDRSTRLEN];
+
+  if (head->ai_addr->sa_family == AF_INET) {
+    struct sockaddr_in *ipv4sock = (struct sockaddr_in *)head->ai_addr;
+    if (!inet_ntop(AF_INET, &ipv4sock->sin_addr, ipstr, sizeof(ipstr))) {
+      perror("Error Converting IP to String");
+      return -1;
+    }
+  } else {
+    strncpy(ipstr, "UNHANDELED", sizeof(ipstr));
+  }
+
+  strncpy(ip, ipstr, size);
+  ip[size - 1] = '\0';
+  return 0;
+}
+
+int lookup_loop_init(lookup_loop_t *loop, int num_tasks) {
+  loop->tasks = calloc(num_tasks, sizeof(lookup_task_t));
+  if (loop->tasks == NULL) {
+    fprintf(stderr, "Error allocating memory for lookup tasks\n");
+    return -1;
+  }
+
+  loop->num_tasks = num_tasks;
+  loop->active = 0;
+  sem_init(&loop->wake, 0, 0);
+  return 0;
+}
+
+void lookup_loop_free(lookup_loop_t *loop) {
+  // notifications still to come point into tasks
+  while (loop->active > 0) {
+    sem_wait(&loop->wake);
+    for (int i = 0; i < loop->num_tasks; i++) {
+      lookup_task_t *task = &loop->tasks[i];
+      if (task->state != TASK_QUERY ||
+          !__atomic_load_n(&task->finished, __ATOMIC_ACQUIRE))
+        continue;
+      if (task->req.ar_result != NULL)
+        freeaddrinfo(task->req.ar_result);
+      task->state = TASK_FETCH;
+      loop->active--;
+    }
+  }
+
+  sem_destroy(&loop->wake);
+  free(loop->tasks);
+}
+
+int lookup_submit(lookup_loop_t *loop, const name_handle_t *host) {
+  if (loop->active == loop->num_tasks)
+    return -1;
+
+  lookup_task_t *task = loop->tasks;
+  while (task->state != TASK_FETCH)
+    task++;
+
+  memset(&task->req, 0, sizeof(task->req));
+  task->host = *host;
+  task->req.ar_name = task->host.name; // hints NULL, as in dnslookup
+  task->finished = 0;
+  task->wake = &loop->wake;
+  task->started = stats_now_ns();
+
+  struct sigevent notify;
+  memset(&notify, 0, sizeof(notify));
+  notify.sigev_notify = SIGEV_THREAD;
+  notify.sigev_notify_function = lookup_done;
+  notify.sigev_value.sival_ptr = task;
+
+  struct gaicb *list[1] = {&task->req};
+  int err = getaddrinfo_a(GAI_NOWAIT, list, 1, &notify);
+  if (err != 0) {
+    fprintf(stderr, "Error looking up Address: %s\n", gai_strerror(err));
+    return -1;
+  }
+
+  task->state = TASK_QUERY;
+  loop->active++;
+  return 0;
+}
+
+// resume the first finished task, 0 if every query is still running
+static int resume_finished(lookup_loop_t *loop, name_handle_t *host, char *ip,
+                           int size, int *resolved, long long *elapsed_ns) {
+  for (int i = 0; i < loop->num_tasks; i++) {
+    lookup_task_t *task = &loop->tasks[i];
+    if (task->state != TASK_QUERY ||
+        !__atomic_load_n(&task->finished, __ATOMIC_ACQUIRE))
+      continue;
+
+    int err = gai_error(&task->req);
+
+    *host = task->host;
+    *elapsed_ns = stats_now_ns() - task->started;
+    *resolved = 0;
+    if (err != 0) {
+      fprintf(stderr, "Error looking up Address: %s\n", gai_strerror(err));
+    } else {
+      *resolved = format_first(task->req.ar_result, ip, size) == 0;
+    }
+    if (task->req.ar_result != NULL) {
+      freeaddrinfo(task->req.ar_result);
+      task->req.ar_result = NULL;
+    }
+
+    task->state = TASK_FETCH;
+    loop->active--;
+    return 1;
+  }
+
+  return 0;
+}
+
+int lookup_next(lookup_loop_t *loop, long long timeout_ns, name_handle_t *host,
+                char *ip, int size, int *resolved, long long *elapsed_ns) {
+  if (loop->active == 0)
+    return 0;
+
+  // one post per finished query, so a successful wait means one is ready
+  int woken;
+  if (timeout_ns < 0) {
+    while ((woken = sem_wait(&loop->wake)) == -1 && errno == EINTR)
+      ;
+  } else if (timeout_ns == 0) {
+    woken = sem_trywait(&loop->wake);
+  } else {
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += timeout_ns / 1000000000LL;
+    deadline.tv_nsec += timeout_ns % 1000000000LL;
+    if (deadline.tv_nsec >= 1000000000L) {
+      deadline.tv_sec++;
+      deadline.tv_nsec -= 1000000000L;
+    }
+    while ((woken = sem_timedwait(&loop->wake, &deadline)) == -1 &&
+           errno == EINTR)
+      ;
+  }
+  if (woken == -1)
+    return 0;
+
+  return resume_finished(loop, host, ip, size, resolved, elapsed_ns);
+}
@@ -0,0 +1,41 @@
+#ifndef LOOKUP_H
+#define LOOKUP_H
+
+#include "array.h"
+#include <semaphore.h>
+
+#define MAX_LOOKUP_TASKS 4096 // queries one resolver thread keeps in flight
+
+// one suspended lookup, defined in lookup.c (needs _GNU_SOURCE for gaicb)
+typedef struct lookup_task lookup_task_t;
+
+/* Event loop state for a resolver running lookups as tasks
+** A task is either idle (waiting for a hostname) or suspended on an
+** asynchronous query; the owning thread resumes it once the query is done
+*/
+typedef struct {
+  lookup_task_t *tasks;
+  int num_tasks;
+  int active; // tasks with a query in flight
+  sem_t wake; // posted once per finished query
+} lookup_loop_t;
+
+int lookup_loop_init(lookup_loop_t *loop, int num_tasks);
+// waits out queries still in flight; their handles are dropped
+void lookup_loop_free(lookup_loop_t *loop);
+
+// issues a non-blocking query for host on an idle task, -1 if none is idle
+// or the query could not be started
+int lookup_submit(lookup_loop_t *loop, const name_handle_t *host);
+
+/* Resumes one task whose query has finished
+** Waits up to timeout_ns for one (0 polls, -1 waits until one finishes)
+** Returns 1 with the task's host and the query's duration filled in, 0 if
+** nothing finished in time
+** On success *resolved is set and ip holds the first address, formatted like
+** dnslookup does; a failed lookup leaves ip untouched
+*/
+int lookup_next(lookup_loop_t *loop, long long timeout_ns, name_handle_t *host,
+                char *ip, int size, int *resolved, long long *elapsed_ns);
+
+#endif
@@ -1,20 +1,23 @@
 #include "multi-lookup.h"
 #include "util.h"
 #include <errno.h>
+#include <fcntl.h> // for AT_FDCWD, O_RDONLY
+#include <limits.h> // for PATH_MAX
 #include <pthread.h>
 #include <semaphore.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <signal.h>
+#include <unistd.h> // for getopt, close, unlink
 
-#define BASE_ARG_NUM 6
-#define DATA_START_IDX 5
+#define BASE_ARG_NUM 5 // positional arguments including one data file
 
 const char *manual =
     "NAME\nmulti-lookup - resolve a set of hostnames to IP "
-    "addresses\n\nSYNOPSIS\nmulti-lookup <# requester> <# resolver> <requester "
-    "log><resolver log> [ <data file> ...]\n\nDESCRIPTION\nThe file names "
+    "addresses\n\nSYNOPSIS\nmulti-lookup [-d [-e]] [-S <socket>] [-c <cache> [-T "
+    "<ttl>]] [-u] [-a <tasks>] [-b] [-n] [-m <manifest>] [-j <scanners>] [-H <hosts>] [-M <metrics>] [-P <workers>] [-o] <# requester> <# resolver> <requester log> <resolver log> [ <data file> ...]\n\nDESCRIPTION\nThe file names "
     "specified by <data file> are passed to the pool of requester threads "
     "which place information into a shared data area. Resolver threads read "
     "the shared data area and find the corresponding IP address.\n\n<# "
@@ -22,8 +25,35 @@ const char *manual =
     "resolvers> number of resolver threads to place into the thread "
     "pool\n<requester log> name of the file into which requested hostnames are "
     "written\n<resolver log> name of the file which hostnames and resolved IP "
-    "addresses are written\n<data file> filename to be processed. Each file "
-    "contains a list of host names, oone per line, that are to be resolved\n";
+    "addresses are written\n<data file> filename, directory (searched recursively) or "
+    "glob pattern to be processed. Each file "
+    "contains a list of host names, oone per line, that are to be resolved\n"
+    "\nOPTIONS\n-d deduplicate hostnames before they are queued; each unique "
+    "name is resolved and written to the resolver log once\n-e with -d, "
+    "expand the resolver log back to one line per occurrence\n-S <socket> run "
+    "as a daemon: serve newline-delimited hostnames on the Unix domain socket "
+    "<socket> (or stdin when <socket> is -), answering \"host, ip\" lines as "
+    "they resolve, until SIGINT or SIGTERM\n-c <cache> consult and update a "
+    "persistent resolution cache file, so repeat runs resolve from cache\n-T "
+    "<ttl> seconds a cached address stays valid (default 3600)\n-u read data "
+    "files through io_uring, several files ahead per requester (falls back to "
+    "blocking reads when io_uring is unavailable)\n-a <tasks> run up to "
+    "<tasks> lookups concurrently on each resolver thread, as tasks that "
+    "suspend while their query is in flight\n-b write the resolver log as "
+    "compact binary records (see results2txt to convert it back to text)\n-n "
+    "lowercase hostnames and answer names that are not valid RFC 1123 "
+    "hostnames as NOT_RESOLVED without a lookup\n-m <manifest> also read "
+    "data files from <manifest>, one per line (- for stdin)\n-j <scanners> "
+    "number of threads walking directory inputs (default 2)\n-H <hosts> answer "
+    "the names in <hosts> (/etc/hosts format) from a static table, without a "
+    "lookup; without -H, a table compiled in from static-hosts.h is used\n-M "
+    "<metrics> rewrite <metrics> every second with live counters (files, "
+    "hosts, hosts/s, queue depths, cache hits, running threads) as JSON\n-P "
+    "<workers> fork <workers> resolver processes per resolver thread and do "
+    "the lookups in them; a worker that crashes is replaced and its lookups "
+    "are retried\n-o write the resolver log in input order (data files in the "
+    "order they are queued, names in file order) while resolvers still run in "
+    "parallel; with -e the duplicate lines follow at the end\n";
 
 void output_mutexes_init(output_mutexes_t *output) {
   pthread_mutex_init(&output->results, NULL);
@@ -50,151 +80,753 @@ void free_resources(array *files, array *hosts, output_mutexes_t *output) {
   output_mutexes_free(output);
 }
 
+// tags host with its place in the resolver log (-o), once there is room
+static void order_hostname(thread_args_t *args, name_handle_t *host) {
+  if (args->reorder == NULL)
+    return;
+  reorder_admit(args->reorder, args->file_seq);
+  host->order = REORDER_KEY(args->file_seq, args->file_names++);
+}
+
+/* Hands one hostname to the resolvers
+** Functionality:
+** - Lowercases the name and answers invalid ones as NOT_RESOLVED (-n)
+** - Drops names the dedup stage has already seen
+** - Puts the handle (tagged with its owner) into the host queue
+** - Logs every name, duplicate or not, to the requester log
+** The handle's arena reference passes to the resolver, or is dropped here
+*/
+int submit_hostname(thread_args_t *args, name_handle_t *host) {
+  stage_stats_t *stats = &args->stats;
+  long long t0;
+
+  // the name sits in this requester's arena, so it is normalized in place
+  int valid = !args->normalize ||
+              hostname_normalize((char *)host->name, host->len) == 0;
+
+  // protect write access to shared output file
+  t0 = stats_now_ns();
+  pthread_mutex_lock(&args->out_locks->serviced);
+  fprintf(args->output_file, "%s\n", host->name);
+  pthread_mutex_unlock(&args->out_locks->serviced);
+  hist_record(&stats->hist[STAGE_OUTPUT_WRITE], stats_now_ns() - t0);
+
+  // only the first occurrence of a name needs an answer, valid or not
+  int first = 1;
+  if (args->dedup != NULL) {
+    first = dedup_insert(args->dedup, host->name);
+    if (first == ERROR) {
+      arena_release(host->page);
+      return ERROR;
+    }
+  }
+
+  if (!first) {
+    counter_inc(&args->num_duplicates);
+    arena_release(host->page);
+    return 0;
+  }
+
+  // no lookup can succeed, answer right here instead of in a resolver
+  if (!valid) {
+    counter_inc(&args->num_invalid);
+    if (args->dedup_expand)
+      dedup_set_result(args->dedup, host->name, NOT_RESOLVED);
+    if (args->reorder != NULL) {
+      order_hostname(args, host);
+      return reorder_put(args->reorder, host, NOT_RESOLVED);
+    }
+    result_write(&args->writer, host->name, NOT_RESOLVED);
+    if (host->owner != NULL)
+      client_reply(host->owner, host->name, NOT_RESOLVED);
+    arena_release(host->page);
+    return 0;
+  }
+
+  order_hostname(args, host);
+
+  // each queued name holds its client open until answered
+  if (host->owner != NULL)
+    client_ref(host->owner);
+
+  t0 = stats_now_ns();
+  if (array_put(args->produce_arr, host) == ERROR) {
+    if (host->owner != NULL)
+      client_unref(host->owner);
+    arena_release(host->page);
+    return ERROR;
+  };
+  hist_record(&stats->hist[STAGE_ENQUEUE_WAIT], stats_now_ns() - t0);
+
+  return 0;
+}
+
+/* Reads one hostname per line from in and submits each
+** Lines are read straight into the requester's arena, so a name is stored
+** once and only its handle travels through the queue
+** read_ns accumulates time spent in fgets only, queue and log writes
+** are timed as their own stages
+*/
+int read_hostnames(thread_args_t *args, FILE *in, long long *read_ns) {
+  long long t0;
+  name_handle_t host;
+
+  while (1) {
+    // room for the longest name plus its newline
+    char *line = arena_reserve(&args->arena, MAX_NAME_LENGTH + 1);
+    if (line == NULL) {
+      return ERROR;
+    }
+
+    t0 = stats_now_ns();
+    char *got = fgets(line, MAX_NAME_LENGTH + 1, in);
+    *read_ns += stats_now_ns() - t0;
+    if (got == NULL) {
+      break;
+    }
+
+    // replace newline with null term
+    // source:
+    // https://stackoverflow.com/questions/2693776/removing-trailing-newline-character-from-fgets-input
+    size_t len = strcspn(line, "\n");
+    int partial = line[len] != '\n' && !feof(in);
+    line[len] = 0;
+
+    if (partial || len >= MAX_NAME_LENGTH) {
+      // longer than any valid name: skip it, including what fgets left
+      int c;
+      while (partial && (c = fgetc(in)) != EOF && c != '\n')
+        ;
+      pthread_mutex_lock(&args->out_locks->serr);
+      fprintf(stderr, "Hostname too long, skipped: %.32s...\n", line);
+      pthread_mutex_unlock(&args->out_locks->serr);
+      continue;
+    }
+
+    arena_commit(&args->arena, len + 1, &host);
+    host.owner = NULL;
+    if (submit_hostname(args, &host) == ERROR) {
+      return ERROR;
+    }
+  }
+
+  return 0;
+}
+
+/* Submits a chunk of lines the daemon read from a client
+** The chunk holds whole lines only, so this never waits on the client; the
+** chunk and its reference to the client are dropped here
+*/
+int read_client(thread_args_t *args, name_handle_t *chunk) {
+  int result = submit_buffer(args, (char *)chunk->name, chunk->len, chunk->owner);
+  free((char *)chunk->name);
+  client_unref(chunk->owner);
+  return result;
+}
+
+/* Submits every line of buf (a whole file, or a daemon client's chunk) as a
+** hostname tagged with owner
+** Each name is copied once, from the read buffer into the arena
+*/
+int submit_buffer(thread_args_t *args, char *buf, size_t len, void *owner) {
+  name_handle_t host;
+  size_t pos = 0;
+
+  while (pos < len) {
+    char *line = buf + pos;
+    char *newline = memchr(line, '\n', len - pos);
+    size_t line_len = newline ? (size_t)(newline - line) : len - pos;
+    pos += line_len + 1;
+
+    if (line_len >= MAX_NAME_LENGTH) {
+      pthread_mutex_lock(&args->out_locks->serr);
+      fprintf(stderr, "Hostname too long, skipped: %.32s...\n", line);
+      pthread_mutex_unlock(&args->out_locks->serr);
+      continue;
+    }
+
+    char *name = arena_reserve(&args->arena, line_len + 1);
+    if (name == NULL) {
+      return ERROR;
+    }
+    memcpy(name, line, line_len);
+    name[line_len] = '\0';
+    arena_commit(&args->arena, line_len + 1, &host);
+    host.owner = owner;
+
+    if (submit_hostname(args, &host) == ERROR) {
+      return ERROR;
+    }
+  }
+
+  return 0;
+}
+
+// queue the next read for slot, growing its buffer when full
+static int ingest_read(uring_t *ring, ingest_slot_t *slot, int idx) {
+  if (slot->len == slot->cap) {
+    size_t cap = slot->cap ? slot->cap * 2 : URING_READ_SIZE;
+    char *buf = realloc(slot->buf, cap);
+    if (buf == NULL) {
+      return ERROR;
+    }
+    slot->buf = buf;
+    slot->cap = cap;
+  }
+
+  struct io_uring_sqe *sqe = uring_get_sqe(ring);
+  if (sqe == NULL) {
+    return ERROR;
+  }
+  sqe->opcode = IORING_OP_READ;
+  sqe->fd = slot->fd;
+  sqe->addr = (unsigned long)(slot->buf + slot->len);
+  sqe->len = slot->cap - slot->len;
+  sqe->off = slot->len;
+  sqe->user_data = idx;
+
+  return 0;
+}
+
+static void ingest_done(thread_args_t *args, ingest_slot_t *slot,
+                        int *inflight) {
+  if (args->reorder != NULL)
+    reorder_file_done(args->reorder, slot->entry.seq, slot->names);
+  arena_release(slot->entry.page); // the file name, if a scanner found it
+  if (slot->fd >= 0)
+    close(slot->fd);
+  slot->fd = -1;
+  slot->len = 0;
+  slot->busy = 0;
+  slot->ready = 0;
+  (*inflight)--;
+}
+
+/* Slot to parse next, -1 if none is ready
+** With -o it is the oldest file held, so this requester never waits for
+** room in the reorder buffer while holding back the file that frees it
+*/
+static int next_ready(thread_args_t *args, ingest_slot_t slots[]) {
+  int next = -1;
+  for (int i = 0; i < URING_FILES_AHEAD; i++) {
+    if (!slots[i].busy)
+      continue;
+    if (args->reorder == NULL) {
+      if (slots[i].ready)
+        return i;
+    } else if (next == -1 || slots[i].entry.seq < slots[next].entry.seq) {
+      next = i;
+    }
+  }
+  return next != -1 && slots[next].ready ? next : -1;
+}
+
+/* io_uring ingestion loop for a requester
+** Opens and reads for several files are in flight at once, so a cold read
+** on one file overlaps with parsing whichever file completed first
+*/
+int ingest_uring(thread_args_t *args, uring_t *ring) {
+  ingest_slot_t slots[URING_FILES_AHEAD];
+  memset(slots, 0, sizeof(slots));
+
+  int inflight = 0;
+  int draining = 0; // poison seen (or the ring failed), take no more files
+  int result = 0;
+  name_handle_t entry;
+
+  while (1) {
+    // top up the read-ahead window, only block when nothing is in flight
+    while (!draining && inflight < URING_FILES_AHEAD) {
+      int got = inflight == 0 ? array_get(args->consume_arr, &entry)
+                              : array_try_get(args->consume_arr, &entry);
+      if (got == ERROR) {
+        result = ERROR;
+        draining = 1;
+        break;
+      }
+      if (got == 1)
+        break; // queue empty, work on what we have
+
+      // lines from a daemon client (checked first, a client may send POISON)
+      if (entry.owner != NULL) {
+        if (read_client(args, &entry) == ERROR) {
+          pthread_mutex_lock(&args->out_locks->serr);
+          fprintf(stderr, "Error reading from client\n");
+          pthread_mutex_unlock(&args->out_locks->serr);
+        }
+        continue;
+      }
+
+      if (strcmp(entry.name, POISON) == 0) {
+        draining = 1;
+        break;
+      }
+
+      int idx = 0;
+      while (slots[idx].busy)
+        idx++;
+      ingest_slot_t *slot = &slots[idx];
+      slot->entry = entry;
+      slot->fd = -1;
+      slot->len = 0;
+      slot->busy = 1;
+      slot->ready = 0;
+      slot->names = 0;
+      slot->started = stats_now_ns();
+
+      inflight++;
+      struct io_uring_sqe *sqe = uring_get_sqe(ring);
+      if (sqe == NULL) {
+        pthread_mutex_lock(&args->out_locks->serr);
+        fprintf(stderr, "Unable to read %s\n", entry.name);
+        pthread_mutex_unlock(&args->out_locks->serr);
+        ingest_done(args, slot, &inflight);
+        result = ERROR;
+        draining = 1;
+        break;
+      }
+      sqe->opcode = IORING_OP_OPENAT;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = (unsigned long)entry.name;
+      sqe->open_flags = O_RDONLY;
+      sqe->user_data = idx;
+    }
+
+    if (inflight == 0)
+      break;
+
+    if (uring_submit_and_wait(ring, 1) == ERROR) {
+      perror("io_uring_enter");
+      result = ERROR;
+      break;
+    }
+
+    struct io_uring_cqe cqe;
+    while (uring_pop_cqe(ring, &cqe) == 0) {
+      int idx = (int)cqe.user_data;
+      ingest_slot_t *slot = &slots[idx];
+
+      if (cqe.res < 0) {
+        pthread_mutex_lock(&args->out_locks->serr);
+        fprintf(stderr, "Invalid file: %s\n", slot->entry.name);
+        pthread_mutex_unlock(&args->out_locks->serr);
+        ingest_done(args, slot, &inflight);
+        result = ERROR;
+        continue;
+      }
+
+      if (slot->fd == -1) {
+        slot->fd = cqe.res; // open completed
+      } else if (cqe.res == 0) {
+        // whole file is in memory, parsed below
+        hist_record(&args->stats.hist[STAGE_FILE_READ],
+                    stats_now_ns() - slot->started);
+        slot->ready = 1;
+        continue;
+      } else {
+        slot->len += cqe.res;
+      }
+
+      if (ingest_read(ring, slot, idx) == ERROR) {
+        pthread_mutex_lock(&args->out_locks->serr);
+        fprintf(stderr, "Unable to read %s\n", slot->entry.name);
+        pthread_mutex_unlock(&args->out_locks->serr);
+        ingest_done(args, slot, &inflight);
+        result = ERROR;
+      }
+    }
+
+    // hand the lines of finished files to the resolvers
+    int idx;
+    while ((idx = next_ready(args, slots)) != -1) {
+      ingest_slot_t *slot = &slots[idx];
+      args->file_seq = slot->entry.seq;
+      args->file_names = 0;
+      if (submit_buffer(args, slot->buf, slot->len, NULL) == ERROR) {
+        result = ERROR;
+        draining = 1;
+      } else {
+        counter_inc(&args->num_serviced);
+      }
+      slot->names = args->file_names;
+      ingest_done(args, slot, &inflight);
+    }
+  }
+
+  // a failed io_uring_enter can leave opens behind
+  for (int i = 0; i < URING_FILES_AHEAD; i++) {
+    if (slots[i].busy)
+      ingest_done(args, &slots[i], &inflight);
+    free(slots[i].buf);
+  }
+
+  return result;
+}
+
 /* Thread routine for requester threads
 ** Functionality:
 ** - Reads filenames from a shared array
 ** - Opens and reads each file in the shared array
 ** - Puts contents of file into another shared array
+** - In daemon mode an entry may instead be a chunk of lines from a client
 */
 void *requester(void *arg) {
   // track method time
   // reason for using clock_gettime:
   // https://stackoverflow.com/questions/5362577/c-gettimeofday-for-computing-time
-  struct timespec start, finish;
-  clock_gettime(CLOCK_MONOTONIC, &start);
+  long long start;
+  start = stats_now_ns();
 
   thread_args_t *args = (thread_args_t *)arg;
   pthread_t thread_id = pthread_self();
+  stage_stats_t *stats = &args->stats;
+  arena_init(&args->arena);
 
   // use result to catch errors
   int result;
   result = 0;
 
-  // args to retrieve file names
-  char file_buf[MAX_FILE_NAME_LENGTH];
-  char *file_name = file_buf;
+  // file names arrive as handles, no copy needed
+  name_handle_t file_entry;
+  const char *file_name;
 
   // vars for reading from file
   FILE *file = NULL;
-  char buffer[MAX_NAME_LENGTH];
+
+  // stage timers
+  long long t0;
+  long long read_ns; // accumulated read time for the current file
+
+  // invalid names (-n) are answered without going through a resolver
+  result_writer_init(&args->writer, args->results_file,
+                     &args->out_locks->results, args->binary_results);
+
+  // io_uring ingestion, falls back to stdio when the kernel refuses it
+  if (args->use_uring) {
+    uring_t ring;
+    // one request per file in flight at most, so the ring never fills (a
+    // full ring would be submitted before taking another entry)
+    if (uring_init(&ring, URING_FILES_AHEAD * 2) == 0) {
+      result = ingest_uring(args, &ring);
+      uring_exit(&ring);
+      goto done;
+    }
+
+    pthread_mutex_lock(&args->out_locks->serr);
+    fprintf(stderr, "io_uring unavailable, using blocking reads\n");
+    pthread_mutex_unlock(&args->out_locks->serr);
+  }
 
   while (1) {
-    // valgrind complained about uninitialized bytes in file_buf
-    // result of extra buffer space + file names that do not fill buf
-    memset(file_buf, 0, sizeof(file_buf));
     // consumption from first shared array
-    if (array_get(args->consume_arr, &file_name) == ERROR) {
+    if (array_get(args->consume_arr, &file_entry) == ERROR) {
       result = ERROR;
       break;
     }
-    file_name[MAX_FILE_NAME_LENGTH - 1] = '\0';
+    file_name = file_entry.name;
+
+    // lines from a daemon client (checked first, a client may send POISON);
+    // a failed client must not take the requester down
+    if (file_entry.owner != NULL) {
+      if (read_client(args, &file_entry) == ERROR) {
+        pthread_mutex_lock(&args->out_locks->serr);
+        fprintf(stderr, "Error reading from client\n");
+        pthread_mutex_unlock(&args->out_locks->serr);
+      }
+      continue;
+    }
 
     // Main thread finished writing file names
     if (strcmp(file_name, POISON) == 0) {
       break;
     }
 
+    t0 = stats_now_ns();
     file = fopen(file_name, "r");
+    read_ns = stats_now_ns() - t0;
     if (file == NULL) {
       pthread_mutex_lock(&args->out_locks->serr);
       fprintf(stderr, "Invalid file: %s\n", file_name);
       pthread_mutex_unlock(&args->out_locks->serr);
 
+      arena_release(file_entry.page);
+      if (args->reorder != NULL)
+        reorder_file_done(args->reorder, file_entry.seq, 0);
+      // fails the job, but the remaining files are still read
       result = ERROR;
-      break;
+      continue;
     }
-
-    // read each line of file - store in buffer
-    while (fgets(buffer, MAX_NAME_LENGTH, file) != NULL) {
-      // replace newline with null term
-      // source:
-      // https://stackoverflow.com/questions/2693776/removing-trailing-newline-character-from-fgets-input
-      buffer[strcspn(buffer, "\n")] = 0;
-      if (array_put(args->produce_arr, buffer) == ERROR) {
-        result = ERROR;
-        break;
-      };
-      // protect write access to shared output file
-      pthread_mutex_lock(&args->out_locks->serviced);
-      fprintf(args->output_file, "%s\n", buffer);
-      pthread_mutex_unlock(&args->out_locks->serviced);
+    // names found by a scanner are owned by its arena, argv ones by nobody
+    arena_release(file_entry.page);
+
+    // read each line of file into the host queue
+    args->file_seq = file_entry.seq;
+    args->file_names = 0;
+    int read_result = read_hostnames(args, file, &read_ns);
+    if (args->reorder != NULL)
+      reorder_file_done(args->reorder, args->file_seq, args->file_names);
+    if (read_result == ERROR) {
+      result = ERROR;
+      fclose(file);
+      break;
     }
-    if (result == ERROR)
-      break; // catch break from loop above
 
+    t0 = stats_now_ns();
     if (fclose(file) != 0) {
       pthread_mutex_lock(&args->out_locks->serr);
       fprintf(stderr, "Unable to close requester file\n");
       pthread_mutex_unlock(&args->out_locks->serr);
     }
+    read_ns += stats_now_ns() - t0;
+    hist_record(&stats->hist[STAGE_FILE_READ], read_ns);
 
-    args->num_serviced++;
+    counter_inc(&args->num_serviced);
   }
 
-  clock_gettime(CLOCK_MONOTONIC, &finish);
+done:
+  if (result_flush(&args->writer) == ERROR) {
+    pthread_mutex_lock(&args->out_locks->serr);
+    fprintf(stderr, "Error writing results\n");
+    pthread_mutex_unlock(&args->out_locks->serr);
+  }
+
+  // pages still holding queued names are freed by the resolvers
+  arena_free(&args->arena);
+
+  args->result = result;
+  args->elapsed_ns = stats_now_ns() - start;
+  counter_set(&args->running, 0);
   // display thread stats
   pthread_mutex_lock(&args->out_locks->sout);
-  fprintf(stdout, "thread %lu serviced %d files in %ld seconds\n", thread_id,
-          args->num_serviced, finish.tv_sec - start.tv_sec);
+  fprintf(stdout, "thread %lu serviced %d files in %.6f seconds\n", thread_id,
+          args->num_serviced, args->elapsed_ns / 1e9);
   pthread_mutex_unlock(&args->out_locks->sout);
 
   return NULL;
 }
 
+/* Writes one finished lookup everywhere it is needed
+** Functionality:
+** - Records the result for duplicate expansion
+** - Writes (hostname, IP) pair to results file
+** - Answers the daemon client that asked, if any
+** - Releases the hostname's arena reference
+*/
+void write_result(thread_args_t *args, name_handle_t *host, const char *ip) {
+  stage_stats_t *stats = &args->stats;
+
+  if (args->dedup_expand) {
+    dedup_set_result(args->dedup, host->name, ip);
+  }
+
+  // in order (-o), the buffer writes the result and drops the name later
+  long long t0 = stats_now_ns();
+  if (args->reorder != NULL) {
+    reorder_put(args->reorder, host, ip);
+  } else {
+    result_write(&args->writer, host->name, ip);
+  }
+
+  // daemon mode: answer the client that asked
+  if (host->owner != NULL) {
+    client_reply(host->owner, host->name, ip);
+    client_unref(host->owner);
+  }
+  hist_record(&stats->hist[STAGE_OUTPUT_WRITE], stats_now_ns() - t0);
+
+  if (args->reorder == NULL)
+    arena_release(host->page);
+  counter_inc(&args->num_serviced);
+}
+
+/* Event loop for a resolver running lookups as tasks
+** Each task takes a hostname, issues its query and suspends; the loop
+** resumes whichever task's query finishes first and writes its result, so
+** up to lookup_tasks lookups are in flight on one thread
+*/
+int resolve_async(thread_args_t *args) {
+  stage_stats_t *stats = &args->stats;
+  // the same loop drives queries in this process or in the workers
+  int workers = args->num_workers > 0;
+  lookup_loop_t loop;
+  worker_pool_t pool;
+  if ((workers ? worker_pool_init(&pool, args->num_workers)
+               : lookup_loop_init(&loop, args->lookup_tasks)) == ERROR) {
+    return ERROR;
+  }
+  int *active = workers ? &pool.active : &loop.active;
+  int capacity = workers ? pool.capacity : loop.num_tasks;
+
+  name_handle_t host;
+  char dns_buf[MAX_IP_LENGTH];
+  int draining = 0; // poison seen, finish what is in flight
+  int result = 0;
+
+  while (1) {
+    // hand new hostnames to idle tasks, only block when none is in flight
+    while (!draining && *active < capacity) {
+      int got = *active == 0 ? array_get(args->consume_arr, &host)
+                             : array_try_get(args->consume_arr, &host);
+      if (got == ERROR) {
+        result = ERROR;
+        draining = 1;
+        break;
+      }
+      if (got == 1)
+        break; // queue empty, go wait on the queries
+
+      // queued names live in a requester arena, a client sending POISON is
+      // just a name
+      if (host.page == NULL && strcmp(host.name, POISON) == 0) {
+        draining = 1;
+        break;
+      }
+      hist_record(&stats->hist[STAGE_QUEUE_RESIDENCE],
+                  stats_now_ns() - host.enqueued);
+
+      // static names and cache hits complete without suspending
+      long long t0 = stats_now_ns();
+      const char *static_ip =
+          args->hosts != NULL ? hosts_lookup(args->hosts, host.name, host.len)
+                              : NULL;
+      if (static_ip != NULL) {
+        counter_inc(&args->num_static_hits);
+        hist_record(&stats->hist[STAGE_LOOKUP], stats_now_ns() - t0);
+        write_result(args, &host, static_ip);
+      } else if (args->cache != NULL &&
+                 cache_lookup(args->cache, host.name, dns_buf, MAX_IP_LENGTH)) {
+        counter_inc(&args->num_cache_hits);
+        hist_record(&stats->hist[STAGE_LOOKUP], stats_now_ns() - t0);
+        write_result(args, &host, dns_buf);
+      } else if ((workers ? worker_pool_submit(&pool, &host)
+                          : lookup_submit(&loop, &host)) == ERROR) {
+        write_result(args, &host, NOT_RESOLVED);
+      }
+    }
+
+    if (*active == 0) {
+      if (draining)
+        break;
+      continue;
+    }
+
+    // new hostnames may arrive while waiting, so only poll for a while
+    long long timeout = draining ? -1 : LOOKUP_POLL_NS;
+    int resolved;
+    long long lookup_ns;
+    while ((workers ? worker_pool_next(&pool, timeout, &host, dns_buf,
+                                       MAX_IP_LENGTH, &resolved, &lookup_ns)
+                    : lookup_next(&loop, timeout, &host, dns_buf,
+                                  MAX_IP_LENGTH, &resolved, &lookup_ns)) == 1) {
+      hist_record(&stats->hist[STAGE_LOOKUP], lookup_ns);
+      if (!resolved) {
+        strncpy(dns_buf, NOT_RESOLVED, MAX_IP_LENGTH);
+        dns_buf[MAX_IP_LENGTH - 1] = '\0';
+      } else if (args->cache != NULL) {
+        cache_insert(args->cache, host.name, dns_buf);
+      }
+      write_result(args, &host, dns_buf);
+      timeout = 0; // collect whatever else already finished
+    }
+  }
+
+  if (workers) {
+    args->num_respawns = pool.respawns;
+    worker_pool_free(&pool);
+  } else {
+    lookup_loop_free(&loop);
+  }
+  return result;
+}
+
 /* Thread routine for resolver threads
 ** Functionality:
 ** - Reads contents from a shared array
 ** - Resolves each hostname into an IP address
 ** - Writes (hostname, IP) pair to results file
+** - Releases the hostname's arena reference once it is written
 */
 void *resolver(void *arg) {
   // track execution time
-  struct timespec start, finish;
-  clock_gettime(CLOCK_MONOTONIC, &start);
+  long long start;
+  start = stats_now_ns();
 
   thread_args_t *args = (thread_args_t *)arg;
   pthread_t thread_id = pthread_self();
+  stage_stats_t *stats = &args->stats;
 
-  // vars to retrieve host names
-  char host_buf[MAX_NAME_LENGTH];
-  char *host_name = host_buf;
+  // host names arrive as handles into requester arenas
+  name_handle_t host;
+  const char *host_name;
 
   // vars to retrieve dns resolved hostname
   char dns_buf[MAX_IP_LENGTH];
   char *dns_store = dns_buf;
 
-  while (1) {
-    // parity with requester
-    memset(host_buf, 0, sizeof(host_buf));
+  long long t0;
+
+  // binary records are batched per thread, text lines go out as before
+  result_writer_init(&args->writer, args->output_file,
+                     &args->out_locks->results, args->binary_results);
+
+  // many lookups in flight on this thread (or its workers) at once
+  if (args->lookup_tasks > 0 || args->num_workers > 0) {
+    resolve_async(args);
+    goto done;
+  }
 
-    if (array_get(args->consume_arr, &host_name) == ERROR) {
+  while (1) {
+    if (array_get(args->consume_arr, &host) == ERROR) {
       break;
     }
-    host_name[MAX_NAME_LENGTH - 1] = '\0';
+    host_name = host.name;
 
-    if (strcmp(host_name, POISON) == 0) {
+    // queued names live in a requester arena, a client sending POISON is
+    // just a name
+    if (host.page == NULL && strcmp(host_name, POISON) == 0) {
       break;
     }
-
-    // resolve hostname
-    if (dnslookup(host_name, dns_store, MAX_IP_LENGTH) == UTIL_FAILURE) {
+    hist_record(&stats->hist[STAGE_QUEUE_RESIDENCE],
+                stats_now_ns() - host.enqueued);
+
+    // resolve hostname: static hosts never touch the network, the cache (if
+    // any) answers repeats across runs
+    t0 = stats_now_ns();
+    const char *static_ip =
+        args->hosts != NULL ? hosts_lookup(args->hosts, host_name, host.len)
+                            : NULL;
+    if (static_ip != NULL) {
+      strncpy(dns_store, static_ip, MAX_IP_LENGTH);
+      counter_inc(&args->num_static_hits);
+    } else if (args->cache != NULL &&
+               cache_lookup(args->cache, host_name, dns_store, MAX_IP_LENGTH)) {
+      counter_inc(&args->num_cache_hits);
+    } else if (dnslookup(host_name, dns_store, MAX_IP_LENGTH) ==
+               UTIL_FAILURE) {
       // copy "NOT_RESOLVED" into buffer
       strncpy(dns_store, NOT_RESOLVED, MAX_IP_LENGTH);
       dns_store[MAX_IP_LENGTH - 1] = '\0';
+    } else if (args->cache != NULL) {
+      cache_insert(args->cache, host_name, dns_store);
     }
+    hist_record(&stats->hist[STAGE_LOOKUP], stats_now_ns() - t0);
 
-    pthread_mutex_lock(&args->out_locks->results);
-    fprintf(args->output_file, "%s, %s\n", host_name, dns_store);
-    pthread_mutex_unlock(&args->out_locks->results);
+    write_result(args, &host, dns_store);
+  }
 
-    args->num_serviced++;
+done:
+  if (result_flush(&args->writer) == ERROR) {
+    pthread_mutex_lock(&args->out_locks->serr);
+    fprintf(stderr, "Error writing results\n");
+    pthread_mutex_unlock(&args->out_locks->serr);
   }
+  args->elapsed_ns = stats_now_ns() - start;
 
-  clock_gettime(CLOCK_MONOTONIC, &finish);
+  counter_set(&args->running, 0);
 
   pthread_mutex_lock(&args->out_locks->sout);
-  fprintf(stdout, "thread %lu resolved %d hosts in %ld seconds\n", thread_id,
-          args->num_serviced, finish.tv_sec - start.tv_sec);
+  fprintf(stdout, "thread %lu resolved %d hosts in %.6f seconds\n", thread_id,
+          args->num_serviced, args->elapsed_ns / 1e9);
   pthread_mutex_unlock(&args->out_locks->sout);
 
   return NULL;
@@ -219,11 +851,17 @@ int spawn_threads(void *(*routine)(void *), pthread_t threads[],
 
     // Each thread gets a unique copy of arguments (on heap)
     // but share common resources to begin
-    args[i]->consume_arr = shared_args->consume_arr;
-    args[i]->produce_arr = shared_args->produce_arr;
-    args[i]->output_file = shared_args->output_file;
-    args[i]->out_locks = shared_args->out_locks;
-    args[i]->num_serviced = shared_args->num_serviced;
+    *args[i] = *shared_args;
+    args[i]->num_serviced = 0;
+    args[i]->num_duplicates = 0;
+    args[i]->num_cache_hits = 0;
+    args[i]->num_invalid = 0;
+    args[i]->num_static_hits = 0;
+    args[i]->num_respawns = 0;
+    args[i]->running = 1;
+    args[i]->result = 0;
+    args[i]->elapsed_ns = 0;
+    stage_stats_init(&args[i]->stats);
 
     result =
         pthread_create(&threads[i], NULL, (void *)routine, (void *)args[i]);
@@ -244,8 +882,13 @@ int poison_shared_array(array *shared, char *poison, int num_pills) {
   int result;
   result = 0;
 
+  name_handle_t pill;
+  memset(&pill, 0, sizeof(pill));
+  pill.name = poison;
+  pill.len = strlen(poison);
+
   for (int i = 0; i < num_pills; i++) {
-    if (array_put(shared, poison) == ERROR) {
+    if (array_put(shared, &pill) == ERROR) {
       result = ERROR;
       break;
     }
@@ -254,64 +897,431 @@ int poison_shared_array(array *shared, char *poison, int num_pills) {
   return result;
 }
 
-int main(int argc, char **argv) {
-  int result;
-  result = 0;
+/* Writes the run report (JSON) next to the resolver log
+** Per-thread histograms are merged here, after every thread has been joined,
+** so the hot path never shares a histogram between threads
+*/
+int write_report(const char *path, thread_args_t *req_args[],
+                 int num_requesters, thread_args_t *res_args[],
+                 int num_resolvers, long long elapsed_ns) {
+  FILE *report = fopen(path, "w");
+  if (report == NULL) {
+    fprintf(stderr, "Invalid filename: %s\n", path);
+    return ERROR;
+  }
 
-  if (argc < BASE_ARG_NUM) {
-    fprintf(stdout, "%s", manual);
+  stage_stats_t *merged = malloc(sizeof(stage_stats_t));
+  if (merged == NULL) {
+    fprintf(stderr, "Error allocating memory for report\n");
+    fclose(report);
+    return ERROR;
+  }
+  stage_stats_init(merged);
+
+  int files = 0;
+  int hosts = 0;
+  int duplicates = 0;
+  int cache_hits = 0;
+  int invalid = 0;
+  int static_hits = 0;
+  int respawns = 0;
+  fprintf(report, "{\n  \"requesters\": %d,\n  \"resolvers\": %d,\n",
+          num_requesters, num_resolvers);
+  fprintf(report, "  \"elapsed_ns\": %lld,\n  \"threads\": [", elapsed_ns);
+  for (int i = 0; i < num_requesters + num_resolvers; i++) {
+    int is_req = i < num_requesters;
+    thread_args_t *args = is_req ? req_args[i] : res_args[i - num_requesters];
+    if (args == NULL)
+      continue; // thread failed to spawn
+
+    stage_stats_merge(merged, &args->stats);
+    if (is_req) {
+      files += args->num_serviced;
+      duplicates += args->num_duplicates;
+      invalid += args->num_invalid;
+    } else {
+      hosts += args->num_serviced;
+      cache_hits += args->num_cache_hits;
+      static_hits += args->num_static_hits;
+      respawns += args->num_respawns;
+    }
+
+    fprintf(report,
+            "%s\n    {\"role\": \"%s\", \"serviced\": %d, \"elapsed_ns\": "
+            "%lld}",
+            i ? "," : "", is_req ? "requester" : "resolver", args->num_serviced,
+            args->elapsed_ns);
+  }
+  fprintf(report, "\n  ],\n  \"files\": %d,\n  \"hosts\": %d,\n", files,
+          hosts);
+  fprintf(report, "  \"duplicates\": %d,\n", duplicates);
+  fprintf(report, "  \"cache_hits\": %d,\n", cache_hits);
+  fprintf(report, "  \"invalid\": %d,\n", invalid);
+  fprintf(report, "  \"static_hits\": %d,\n", static_hits);
+  fprintf(report, "  \"worker_respawns\": %d,\n", respawns);
+  fprintf(report, "  \"stages\": ");
+  stats_write_json(report, merged);
+  fprintf(report, "\n}\n");
+
+  free(merged);
+  if (fclose(report) == EOF) {
+    fprintf(stderr, "Error closing file");
     return ERROR;
   }
 
+  return 0;
+}
+
+int write_metrics(metrics_t *m, int *prev_hosts, long long *prev_ns) {
+  int files = 0, hosts = 0, duplicates = 0, invalid = 0;
+  int cache_hits = 0, static_hits = 0;
+  int requesters = 0, resolvers = 0;
+
+  for (int i = 0; i < m->num_requesters + m->num_resolvers; i++) {
+    int is_req = i < m->num_requesters;
+    thread_args_t *args =
+        is_req ? m->req_args[i] : m->res_args[i - m->num_requesters];
+    if (args == NULL)
+      continue; // thread failed to spawn
+
+    int running = counter_read(&args->running);
+    if (is_req) {
+      files += counter_read(&args->num_serviced);
+      duplicates += counter_read(&args->num_duplicates);
+      invalid += counter_read(&args->num_invalid);
+      requesters += running;
+    } else {
+      hosts += counter_read(&args->num_serviced);
+      cache_hits += counter_read(&args->num_cache_hits);
+      static_hits += counter_read(&args->num_static_hits);
+      resolvers += running;
+    }
+  }
+
+  // filled slots; racy by nature, but each value was true at some point
+  int file_depth = 0, host_depth = 0;
+  sem_getvalue(&m->file_store->full, &file_depth);
+  sem_getvalue(&m->host_store->full, &host_depth);
+
+  long long now = stats_now_ns();
+  double rate = now > *prev_ns ? (hosts - *prev_hosts) * 1e9 / (now - *prev_ns)
+                               : 0.0;
+  *prev_hosts = hosts;
+  *prev_ns = now;
+
+  char tmp_path[PATH_MAX];
+  snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", m->path);
+  FILE *out = fopen(tmp_path, "w");
+  if (out == NULL) {
+    return ERROR;
+  }
+
+  fprintf(out, "{\n  \"elapsed_ns\": %lld,\n", now - m->start);
+  fprintf(out, "  \"files\": %d,\n  \"hosts\": %d,\n", files, hosts);
+  fprintf(out, "  \"hosts_per_sec\": %.1f,\n", rate);
+  fprintf(out, "  \"duplicates\": %d,\n  \"invalid\": %d,\n", duplicates,
+          invalid);
+  fprintf(out, "  \"cache_hits\": %d,\n  \"static_hits\": %d,\n", cache_hits,
+          static_hits);
+  fprintf(out, "  \"cache_hit_rate\": %.4f,\n",
+          hosts > 0 ? (double)cache_hits / hosts : 0.0);
+  fprintf(out, "  \"file_store_depth\": %d,\n  \"host_store_depth\": %d,\n",
+          file_depth, host_depth);
+  fprintf(out, "  \"requesters_running\": %d,\n  \"resolvers_running\": %d\n}\n",
+          requesters, resolvers);
+
+  // readers only ever see a whole snapshot
+  if (fclose(out) == EOF || rename(tmp_path, m->path) == -1) {
+    unlink(tmp_path);
+    return ERROR;
+  }
+
+  return 0;
+}
+
+static void *metrics_thread(void *arg) {
+  metrics_t *m = arg;
+  int prev_hosts = 0;
+  long long prev_ns = m->start;
+  int reported = 0; // complain about a failing file once
+
+  pthread_mutex_lock(&m->lock);
+  for (;;) {
+    struct timespec deadline;
+    clock_gettime(CLOCK_MONOTONIC, &deadline);
+    deadline.tv_sec += METRICS_INTERVAL_NS / 1000000000LL;
+    while (!m->stop &&
+           pthread_cond_timedwait(&m->cond, &m->lock, &deadline) != ETIMEDOUT)
+      ;
+    int stop = m->stop;
+    pthread_mutex_unlock(&m->lock);
+
+    if (write_metrics(m, &prev_hosts, &prev_ns) == ERROR && !reported) {
+      pthread_mutex_lock(&m->out_locks->serr);
+      fprintf(stderr, "Error writing metrics: %s\n", m->path);
+      pthread_mutex_unlock(&m->out_locks->serr);
+      reported = 1;
+    }
+    if (stop)
+      break;
+    pthread_mutex_lock(&m->lock);
+  }
+
+  return NULL;
+}
+
+int metrics_start(metrics_t *m) {
+  m->stop = 0;
+  pthread_mutex_init(&m->lock, NULL);
+  pthread_condattr_t attr;
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&m->cond, &attr);
+  pthread_condattr_destroy(&attr);
+
+  if (pthread_create(&m->tid, NULL, metrics_thread, m) != 0) {
+    fprintf(stderr, "Failed to create thread\n");
+    pthread_cond_destroy(&m->cond);
+    pthread_mutex_destroy(&m->lock);
+    return ERROR;
+  }
+
+  return 0;
+}
+
+void metrics_stop(metrics_t *m) {
+  pthread_mutex_lock(&m->lock);
+  m->stop = 1;
+  pthread_cond_signal(&m->cond);
+  pthread_mutex_unlock(&m->lock);
+
+  pthread_join(m->tid, NULL);
+  pthread_cond_destroy(&m->cond);
+  pthread_mutex_destroy(&m->lock);
+}
+
+/* Parses flags and positional arguments into opts
+** Flags must precede the positional arguments
+*/
+int parse_options(int argc, char **argv, options_t *opts) {
+  memset(opts, 0, sizeof(*opts));
+
   char *endptr; // stores first invalid character from strtol
+  int opt;
+  // leading '+' stops at the first positional argument
+  opts->cache_ttl = CACHE_DEFAULT_TTL;
+  opts->num_scanners = DEFAULT_SCANNERS;
+  while ((opt = getopt(argc, argv, "+deS:c:T:ua:bnm:j:H:M:P:o")) != -1) {
+    switch (opt) {
+    case 'd':
+      opts->dedup = 1;
+      break;
+    case 'e':
+      opts->dedup_expand = 1;
+      break;
+    case 'S':
+      opts->daemon_path = optarg;
+      break;
+    case 'c':
+      opts->cache_path = optarg;
+      break;
+    case 'u':
+      opts->use_uring = 1;
+      break;
+    case 'b':
+      opts->binary_results = 1;
+      break;
+    case 'n':
+      opts->normalize = 1;
+      break;
+    case 'o':
+      opts->ordered = 1;
+      break;
+    case 'm':
+      opts->manifest_path = optarg;
+      break;
+    case 'H':
+      opts->hosts_path = optarg;
+      break;
+    case 'M':
+      opts->metrics_path = optarg;
+      break;
+    case 'j':
+      opts->num_scanners = strtol(optarg, &endptr, 10);
+      if (*endptr != '\0' || opts->num_scanners < 1 ||
+          opts->num_scanners > MAX_SCANNERS) {
+        fprintf(stderr, "Invalid number of scanner threads: %s\n", optarg);
+        return ERROR;
+      }
+      break;
+    case 'a':
+      opts->lookup_tasks = strtol(optarg, &endptr, 10);
+      if (*endptr != '\0' || opts->lookup_tasks < 1 ||
+          opts->lookup_tasks > MAX_LOOKUP_TASKS) {
+        fprintf(stderr, "Invalid number of lookup tasks: %s\n", optarg);
+        return ERROR;
+      }
+      break;
+    case 'P':
+      opts->num_workers = strtol(optarg, &endptr, 10);
+      if (*endptr != '\0' || opts->num_workers < 1 ||
+          opts->num_workers > MAX_WORKERS) {
+        fprintf(stderr, "Invalid number of resolver workers: %s\n", optarg);
+        return ERROR;
+      }
+      break;
+    case 'T':
+      opts->cache_ttl = strtol(optarg, &endptr, 10);
+      if (*endptr != '\0' || opts->cache_ttl <= 0) {
+        fprintf(stderr, "Invalid cache TTL: %s\n", optarg);
+        return ERROR;
+      }
+      break;
+    default:
+      fprintf(stdout, "%s", manual);
+      return ERROR;
+    }
+  }
+
+  if (opts->dedup_expand && !opts->dedup) {
+    fprintf(stderr, "-e requires -d\n");
+    return ERROR;
+  }
+
+  // clients are answered as their names resolve, there is no input order
+  if (opts->daemon_path != NULL && opts->ordered) {
+    fprintf(stderr, "-o cannot be combined with -S\n");
+    return ERROR;
+  }
+
+  if (opts->lookup_tasks > 0 && opts->num_workers > 0) {
+    fprintf(stderr, "-a cannot be combined with -P\n");
+    return ERROR;
+  }
+
+  // answers go straight back to each client, every request is looked up
+  if (opts->daemon_path != NULL && opts->dedup) {
+    fprintf(stderr, "-d cannot be combined with -S\n");
+    return ERROR;
+  }
+
+  if (opts->daemon_path != NULL && opts->manifest_path != NULL &&
+      strcmp(opts->daemon_path, STDIN_STREAM) == 0 &&
+      strcmp(opts->manifest_path, "-") == 0) {
+    fprintf(stderr, "-S - and -m - cannot both read stdin\n");
+    return ERROR;
+  }
+
+  // a daemon takes its hostnames from clients, -m lists the data files
+  if (argc - optind <
+      BASE_ARG_NUM - (opts->daemon_path != NULL || opts->manifest_path != NULL)) {
+    fprintf(stdout, "%s", manual);
+    return ERROR;
+  }
+  char **pos = argv + optind;
+
   errno = 0;    // strtol only modifies errno on error
-  long num_requesters;
-  long num_resolvers;
-  FILE *serviced;
-  FILE *results;
+  opts->num_requesters = strtol(pos[0], &endptr, 10);
+  if (errno != 0 || *endptr != '\0' ||
+      opts->num_requesters > MAX_REQUESTER_THREADS ||
+      opts->num_requesters < 0) {
+    fprintf(stderr, "Invalid number of requester threads: %s\n", pos[0]);
+    return ERROR;
+  }
 
-  // TODO: move argument parsing / handling into a separate method to clean up
-  // main
-  num_requesters = strtol(argv[1], &endptr, 10);
-  if (errno != 0 || *endptr != '\0' || num_requesters > MAX_REQUESTER_THREADS ||
-      num_requesters < 0) {
-    fprintf(stderr, "Invalid number of requester threads: %s\n", argv[1]);
+  opts->num_resolvers = strtol(pos[1], &endptr, 10);
+  if (errno != 0 || *endptr != '\0' ||
+      opts->num_resolvers > MAX_RESOLVER_THREADS || opts->num_resolvers < 0) {
+    fprintf(stderr, "Invalid number of resolver threads: %s\n", pos[1]);
     return ERROR;
   }
 
-  num_resolvers = strtol(argv[2], &endptr, 10);
-  if (errno != 0 || *endptr != '\0' || num_resolvers > MAX_RESOLVER_THREADS ||
-      num_resolvers < 0) {
-    fprintf(stderr, "Invalid number of requester threads: %s\n", argv[2]);
+  opts->serviced_path = pos[2];
+  opts->results_path = pos[3];
+  opts->data_files = pos + 4;
+  opts->num_data_files = argc - optind - 4;
+
+  return 0;
+}
+
+// releases what main set up before the job when it fails to start
+static void release_inputs(const options_t *opts, cache_t *cache,
+                           hosts_table_t *hosts_table) {
+  if (opts->cache_path != NULL)
+    cache_close(cache);
+  if (opts->hosts_path != NULL)
+    hosts_free(hosts_table);
+}
+
+int main(int argc, char **argv) {
+  int result;
+  result = 0;
+
+  options_t opts;
+  if (parse_options(argc, argv, &opts) == ERROR) {
     return ERROR;
   }
+  long num_requesters = opts.num_requesters;
+  long num_resolvers = opts.num_resolvers;
+
+  // warm start: the cache file is mapped, not parsed; a bad one stops the
+  // job before the output files are truncated
+  cache_t cache;
+  if (opts.cache_path != NULL &&
+      cache_open(&cache, opts.cache_path, opts.cache_ttl) == ERROR) {
+    return ERROR;
+  }
+
+  // static hosts: the perfect hash is built once, before any lookup, and a
+  // bad table stops the job like a bad cache
+  hosts_table_t hosts_table;
+  const hosts_table_t *hosts = hosts_builtin();
+  if (opts.hosts_path != NULL) {
+    if (hosts_load(&hosts_table, opts.hosts_path) == ERROR) {
+      if (opts.cache_path != NULL)
+        cache_close(&cache);
+      return ERROR;
+    }
+    hosts = &hosts_table;
+  }
 
-  serviced = fopen(argv[3], "w");
+  FILE *serviced;
+  FILE *results;
+
+  serviced = fopen(opts.serviced_path, "w");
   if (serviced == NULL) {
-    fprintf(stderr, "Invalid filename: %s\n", argv[3]);
+    fprintf(stderr, "Invalid filename: %s\n", opts.serviced_path);
+    release_inputs(&opts, &cache, &hosts_table);
     return ERROR;
   }
 
-  results = fopen(argv[4], "w");
+  results = fopen(opts.results_path, "w");
   if (results == NULL) {
-    fprintf(stderr, "Invalid filename: %s\n", argv[4]);
+    fprintf(stderr, "Invalid filename: %s\n", opts.results_path);
+    fclose(serviced);
+    release_inputs(&opts, &cache, &hosts_table);
+    return ERROR;
+  }
+  if (opts.binary_results && results_write_header(results) == ERROR) {
+    fprintf(stderr, "Error writing %s\n", opts.results_path);
+    fclose(serviced);
+    fclose(results);
+    release_inputs(&opts, &cache, &hosts_table);
     return ERROR;
   }
 
-  int num_data_files;
-  // 1 index the starting index for data files
-  num_data_files = argc - (DATA_START_IDX + 1);
-  if (num_data_files > MAX_INPUT_FILES) {
-    fprintf(stderr, "Invalid number of data files: %d\n", num_data_files);
-
+  // optional dedup stage shared by every requester
+  dedup_set_t dedup;
+  if (opts.dedup && dedup_init(&dedup, DEDUP_BUCKETS) == ERROR) {
     fclose(serviced);
     fclose(results);
+    release_inputs(&opts, &cache, &hosts_table);
     return ERROR;
   }
 
   // start timer after argument parsing
-  struct timespec start, finish;
-  clock_gettime(CLOCK_MONOTONIC, &start);
+  long long start;
+  start = stats_now_ns();
 
   // initialize synchronization resources
   array file_store;
@@ -319,17 +1329,39 @@ int main(int argc, char **argv) {
   output_mutexes_t output;
   init_resources(&file_store, &host_store, &output);
 
+  // daemon: only main should see stop signals, threads inherit this mask
+  sigset_t stop_signals;
+  sigemptyset(&stop_signals);
+  sigaddset(&stop_signals, SIGINT);
+  sigaddset(&stop_signals, SIGTERM);
+  if (opts.daemon_path != NULL) {
+    pthread_sigmask(SIG_BLOCK, &stop_signals, NULL);
+  }
+
+  // -o: every result goes through one buffer that restores input order
+  reorder_t reorder;
+  if (opts.ordered) {
+    reorder_init(&reorder, results, &output.results, opts.binary_results);
+  }
+
   int thread_result;
   // setup requesters
   pthread_t req_tid[num_requesters];
   thread_args_t *req_args[num_requesters];
   // define args common across requesters
   thread_args_t shared_req_args;
+  memset(&shared_req_args, 0, sizeof(shared_req_args));
   shared_req_args.consume_arr = &file_store;
   shared_req_args.produce_arr = &host_store;
   shared_req_args.output_file = serviced;
   shared_req_args.out_locks = &output;
-  shared_req_args.num_serviced = 0;
+  shared_req_args.dedup = opts.dedup ? &dedup : NULL;
+  shared_req_args.dedup_expand = opts.dedup_expand; // for invalid names
+  shared_req_args.use_uring = opts.use_uring;
+  shared_req_args.normalize = opts.normalize;
+  shared_req_args.results_file = results;
+  shared_req_args.binary_results = opts.binary_results;
+  shared_req_args.reorder = opts.ordered ? &reorder : NULL;
 
   thread_result = spawn_threads(requester, req_tid, req_args, &shared_req_args,
                                 num_requesters);
@@ -340,15 +1372,23 @@ int main(int argc, char **argv) {
 
   // setup resolvers
   pthread_t res_tid[num_resolvers];
-  thread_args_t *res_args[num_requesters];
+  thread_args_t *res_args[num_resolvers];
 
   // define args common across resolvers
   thread_args_t shared_res_args;
+  memset(&shared_res_args, 0, sizeof(shared_res_args));
   shared_res_args.consume_arr = &host_store;
   shared_res_args.produce_arr = NULL; // resolvers do not produce
   shared_res_args.output_file = results;
   shared_res_args.out_locks = &output;
-  shared_res_args.num_serviced = 0;
+  shared_res_args.dedup = opts.dedup ? &dedup : NULL;
+  shared_res_args.dedup_expand = opts.dedup_expand;
+  shared_res_args.cache = opts.cache_path != NULL ? &cache : NULL;
+  shared_res_args.hosts = hosts;
+  shared_res_args.lookup_tasks = opts.lookup_tasks;
+  shared_res_args.num_workers = opts.num_workers;
+  shared_res_args.binary_results = opts.binary_results;
+  shared_res_args.reorder = opts.ordered ? &reorder : NULL;
 
   thread_result = spawn_threads(resolver, res_tid, res_args, &shared_res_args,
                                 num_resolvers);
@@ -359,27 +1399,67 @@ int main(int argc, char **argv) {
     goto cleanup;
   }
 
-  // write filenames to first shared array
-  for (int i = DATA_START_IDX; i < argc; i++) {
-    if (array_put(&file_store, argv[i]) == ERROR) {
-      pthread_mutex_lock(&output.serr);
-      fprintf(stderr, "Failed to write to shared array\n");
-      pthread_mutex_unlock(&output.serr);
+  // live metrics read the thread args, so stop before they are freed
+  metrics_t metrics;
+  if (opts.metrics_path != NULL) {
+    metrics.path = opts.metrics_path;
+    metrics.file_store = &file_store;
+    metrics.host_store = &host_store;
+    metrics.req_args = req_args;
+    metrics.num_requesters = num_requesters;
+    metrics.res_args = res_args;
+    metrics.num_resolvers = num_resolvers;
+    metrics.out_locks = &output;
+    metrics.start = start;
+    if (metrics_start(&metrics) == ERROR) {
+      opts.metrics_path = NULL;
+      result = ERROR;
+    }
+  }
+
+  // daemon: pools stay up while clients come and go
+  if (opts.daemon_path != NULL && serve(opts.daemon_path, &file_store) == ERROR) {
+    result = ERROR;
+  }
 
+  // file names stream into the first shared array as they are found, the
+  // requesters are already reading; argv outlives them, so its strings are
+  // queued in place
+  scanner_t scan;
+  if (scanner_start(&scan, &file_store, opts.num_scanners) == ERROR) {
+    result = ERROR;
+    if (opts.metrics_path != NULL) {
+      metrics_stop(&metrics);
+    }
+    goto cleanup;
+  }
+  for (int i = 0; i < opts.num_data_files; i++) {
+    if (scanner_add(&scan, opts.data_files[i], 1) == ERROR) {
       result = ERROR;
-      goto cleanup;
+      break;
     }
   }
+  if (result != ERROR && opts.manifest_path != NULL &&
+      scanner_add_manifest(&scan, opts.manifest_path) == ERROR) {
+    result = ERROR;
+  }
+  scanner_finish(&scan);
+
+  if (result == ERROR) {
+    pthread_mutex_lock(&output.serr);
+    fprintf(stderr, "Failed to write to shared array\n");
+    pthread_mutex_unlock(&output.serr);
+  }
 
   // poison requesters after filling buffer with all file names
   poison_shared_array(&file_store, POISON, num_requesters);
 
   // wait / join threads
-  // cleanup dynamic thread args
   for (int i = 0; i < num_requesters; i++) {
     pthread_join(req_tid[i], NULL);
-    free(req_args[i]);
-    req_args[i] = NULL;
+    if (req_args[i]->result == ERROR) {
+      result = ERROR;
+    }
   }
 
   // poison resolvers after all requesters finish
@@ -387,12 +1467,63 @@ int main(int argc, char **argv) {
 
   for (int i = 0; i < num_resolvers; i++) {
     pthread_join(res_tid[i], NULL);
+  }
+
+  // only results after a gap (a file that failed part way) are left
+  if (opts.ordered && reorder_finish(&reorder) == ERROR) {
+    fprintf(stderr, "Error writing results\n");
+    result = ERROR;
+  }
+
+  if (opts.metrics_path != NULL) {
+    metrics_stop(&metrics);
+  }
+
+  // every unique name now has its result, fan them back out
+  if (opts.dedup_expand) {
+    // resolvers are joined, main is the only writer left
+    result_writer_t *expand = malloc(sizeof(result_writer_t));
+    if (expand == NULL) {
+      fprintf(stderr, "Error allocating memory for results\n");
+      result = ERROR;
+    } else {
+      result_writer_init(expand, results, NULL, opts.binary_results);
+      dedup_write_duplicates(&dedup, expand);
+      result_flush(expand);
+      free(expand);
+    }
+  }
+
+  // report needs the per-thread stats before the args are released
+  char report_path[PATH_MAX];
+  snprintf(report_path, sizeof(report_path), "%s%s", opts.results_path,
+           REPORT_SUFFIX);
+  if (write_report(report_path, req_args, num_requesters, res_args,
+                   num_resolvers, stats_now_ns() - start) == ERROR) {
+    result = ERROR;
+  }
+
+  // cleanup dynamic thread args
+  for (int i = 0; i < num_requesters; i++) {
+    free(req_args[i]);
+    req_args[i] = NULL;
+  }
+  for (int i = 0; i < num_resolvers; i++) {
     free(res_args[i]);
     res_args[i] = NULL;
   }
 
 cleanup:
   free_resources(&file_store, &host_store, &output);
+  if (opts.dedup) {
+    dedup_free(&dedup);
+  }
+  if (opts.cache_path != NULL && cache_close(&cache) == ERROR) {
+    result = ERROR;
+  }
+  if (opts.hosts_path != NULL) {
+    hosts_free(&hosts_table);
+  }
 
   if (fclose(serviced) == EOF) {
     fprintf(stderr, "Error closing file");
@@ -404,9 +1535,8 @@ cleanup:
     result = ERROR;
   }
 
-  clock_gettime(CLOCK_MONOTONIC, &finish);
-  fprintf(stdout, "%s: total time is %ld seconds\n", argv[0],
-          finish.tv_sec - start.tv_sec);
+  fprintf(stdout, "%s: total time is %.6f seconds\n", argv[0],
+          (stats_now_ns() - start) / 1e9);
 
   return result;
 }
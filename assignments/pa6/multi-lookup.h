@@ -1,19 +1,35 @@
 #ifndef MULTI_LOOKUP_H
 #define MULTI_LOOKUP_H
 
+#include "arena.h"
 #include "array.h"
+#include "cache.h"
+#include "daemon.h"
+#include "dedup.h"
+#include "hosts.h"
+#include "lookup.h"
+#include "normalize.h"
+#include "reorder.h"
+#include "results.h"
+#include "scan.h"
+#include "stats.h"
+#include "uring.h"
+#include "workers.h"
 #include <netinet/in.h> // for INET6_ADDRSTRLEN
 #include <pthread.h>
 #include <stdio.h>
 
-#define MAX_FILE_NAME_LENGTH 20 // names51.txt (11) + input/ (6) ~ 17 + 3 extra
-#define MAX_INPUT_FILES 100
 #define MAX_REQUESTER_THREADS 10
 #define MAX_RESOLVER_THREADS 10
 #define MAX_IP_LENGTH INET6_ADDRSTRLEN
 #define POISON "{END}" // braces not allowed in hostnames
 #define ERROR -1
 #define NOT_RESOLVED "NOT_RESOLVED"
+#define REPORT_SUFFIX ".report.json" // appended to the resolver log name
+#define URING_FILES_AHEAD 4           // files a requester reads concurrently
+#define URING_READ_SIZE (256 * 1024)  // initial read buffer per file
+#define LOOKUP_POLL_NS 1000000LL     // resolver recheck of the host queue
+#define METRICS_INTERVAL_NS 1000000000LL // between rewrites of the -M file
 
 typedef struct {
   pthread_mutex_t serviced;
@@ -22,6 +38,31 @@ typedef struct {
   pthread_mutex_t serr;
 } output_mutexes_t;
 
+// Command line configuration
+typedef struct {
+  long num_requesters;
+  long num_resolvers;
+  char *serviced_path; // requester log
+  char *results_path;  // resolver log
+  char **data_files;
+  int num_data_files;
+  int dedup;        // -d: skip hostnames already queued
+  int dedup_expand; // -e: write a results line for every duplicate too
+  char *daemon_path; // -S: serve lookups on this socket ("-" for stdin)
+  char *cache_path;  // -c: persistent resolution cache file
+  long cache_ttl;    // -T: seconds a cached address stays valid
+  int use_uring;     // -u: requesters read files through io_uring
+  long lookup_tasks; // -a: concurrent lookups per resolver, 0 = blocking
+  int binary_results; // -b: resolver log holds binary records, not text
+  int normalize;      // -n: lowercase names, answer invalid ones directly
+  char *manifest_path; // -m: file listing further inputs
+  long num_scanners;   // -j: threads walking directory inputs
+  char *hosts_path;    // -H: names answered from a static table
+  char *metrics_path;  // -M: live metrics file, rewritten every second
+  long num_workers;    // -P: resolver processes per resolver thread
+  int ordered;         // -o: resolver log in input order
+} options_t;
+
 // Key interfaces
 typedef struct {
   array *consume_arr; // shared array to consume data from
@@ -29,7 +70,31 @@ typedef struct {
   FILE *output_file;  // file to log results
   output_mutexes_t
       *out_locks; // mutexes for exclusive access to output (file, stdout, ...)
+  dedup_set_t *dedup; // hostnames already queued, NULL when disabled
+  int dedup_expand;    // record results (and invalid answers) for expansion
+  cache_t *cache;      // persistent resolution cache, NULL when disabled
+  const hosts_table_t *hosts; // static names, NULL when there are none
+  int use_uring;       // requester: ingest files through io_uring
+  int normalize;       // requester: lowercase and validate each name
+  FILE *results_file;  // requester: invalid names are answered here
+  int lookup_tasks;    // resolver: lookups in flight at once, 0 = blocking
+  int num_workers;     // resolver: worker processes doing its lookups
+  int binary_results;  // results are written as binary records
+  result_writer_t writer; // buffers this thread's results for the log
+  reorder_t *reorder;  // puts results in input order (-o), NULL when off
+  unsigned long long file_seq; // requester: file being read (-o)
+  long file_names;             // requester: names it has submitted (-o)
   int num_serviced;
+  int num_duplicates;   // hostnames dropped by the dedup stage
+  int num_cache_hits;   // lookups answered by the cache
+  int num_invalid;      // names rejected without a lookup
+  int num_static_hits;  // lookups answered by the static hosts table
+  int num_respawns;     // worker processes replaced after a crash
+  int running;          // cleared when the routine returns (counter_read)
+  int result;           // requester: ERROR if a file failed, for the exit status
+  arena_t arena;        // requester: storage for the names it queues
+  long long elapsed_ns; // wall time of the thread routine
+  stage_stats_t stats;  // per-thread stage latencies, merged by main
 } thread_args_t;
 
 void output_synchronize_init(output_mutexes_t *output);
@@ -38,6 +103,49 @@ void output_synchronize_free(output_mutexes_t *output);
 void init_resources(array *files, array *host, output_mutexes_t *output);
 void free_resources(array *files, array *host, output_mutexes_t *output);
 
+/* Hands one hostname to the resolvers
+** Functionality:
+** - Lowercases the name (-n)
+** - Drops names the dedup stage has already seen
+** - Answers invalid names as NOT_RESOLVED (-n)
+** - Tags the name with its output position, waiting for room (-o)
+** - Puts the handle (tagged with its owner) into the host queue
+** - Logs every name, duplicate or not, to the requester log
+*/
+int submit_hostname(thread_args_t *args, name_handle_t *host);
+
+// reads one hostname per line from in and submits each
+int read_hostnames(thread_args_t *args, FILE *in, long long *read_ns);
+
+// submits a chunk of lines the daemon read from a client, then drops it
+int read_client(thread_args_t *args, name_handle_t *chunk);
+
+// one file being read ahead by an io_uring requester
+typedef struct {
+  name_handle_t entry; // file name from file_store
+  int fd;              // -1 until the open completes
+  char *buf;           // whole file, parsed once the read hits EOF
+  size_t len;
+  size_t cap;
+  long long started; // open submission time, for the file read stage
+  int busy;
+  int ready;  // read to EOF, waiting to be parsed
+  long names; // submitted from the file, reported when the slot is done
+} ingest_slot_t;
+
+// submits every line of buf (a whole file or a client's chunk) as a
+// hostname tagged with owner
+int submit_buffer(thread_args_t *args, char *buf, size_t len, void *owner);
+
+/* io_uring ingestion loop for a requester
+** Functionality:
+** - Keeps up to URING_FILES_AHEAD files open and reading at once
+** - Parses whichever file finishes reading first (with -o, the oldest file
+**   it holds, once that one is read)
+** - Returns once a poison pill has been seen and every file is done
+*/
+int ingest_uring(thread_args_t *args, uring_t *ring);
+
 /* Thread routine for requester threads
 ** Functionality:
 ** - Reads filenames from a shared array
@@ -46,6 +154,23 @@ void free_resources(array *files, array *host, output_mutexes_t *output);
 */
 void *requester(void *arg);
 
+/* Writes one finished lookup everywhere it is needed
+** Functionality:
+** - Writes (hostname, IP) pair to results file (and the daemon client)
+** - Releases the hostname's arena reference
+*/
+void write_result(thread_args_t *args, name_handle_t *host, const char *ip);
+
+/* Event loop for a resolver running lookups as tasks (-a) or in worker
+** processes (-P)
+** Functionality:
+** - Feeds hostnames to idle tasks (or the least loaded worker), each issues
+**   a non-blocking query
+** - Resumes tasks as their queries finish and writes the results
+** - Returns once a poison pill has been seen and every task is idle
+*/
+int resolve_async(thread_args_t *args);
+
 /* Thread routine for resolver threads
 ** Functionality:
 ** - Reads contents from a shared array
@@ -63,5 +188,55 @@ int spawn_threads(void *(*routine)(void *), pthread_t threads[],
 
 int poison_shared_array(array *shared, char *poison, int num_pills);
 
+/* Live metrics of a running job (-M)
+** A thread samples the per-thread counters and the queue depths every
+** METRICS_INTERVAL_NS and rewrites the file (write to path.tmp, rename),
+** so a reader always sees one complete snapshot; nothing on the hot path
+** takes a lock for it
+*/
+typedef struct {
+  const char *path;
+  array *file_store;
+  array *host_store;
+  thread_args_t **req_args;
+  int num_requesters;
+  thread_args_t **res_args;
+  int num_resolvers;
+  output_mutexes_t *out_locks;
+  long long start; // job start, for the elapsed time
+  int stop;
+  pthread_mutex_t lock; // guards stop
+  pthread_cond_t cond;  // signalled on stop, CLOCK_MONOTONIC
+  pthread_t tid;
+} metrics_t;
+
+/* Writes one snapshot of the job to m->path
+** Functionality:
+** - Sums the per-thread counters and counts the threads still running
+** - Reads the queue depths of both shared arrays
+** - Derives hosts per second from the previous snapshot
+*/
+int write_metrics(metrics_t *m, int *prev_hosts, long long *prev_ns);
+
+// starts the metrics thread; the thread args must outlive metrics_stop
+int metrics_start(metrics_t *m);
+
+// stops the metrics thread after it writes a final snapshot
+void metrics_stop(metrics_t *m);
+
+/* Parses flags and positional arguments into opts
+** Returns ERROR (after printing the reason) on invalid input
+*/
+int parse_options(int argc, char **argv, options_t *opts);
+
+/* Writes the run report (JSON) next to the resolver log
+** Functionality:
+** - Merges the per-thread stage histograms
+** - Records per-thread totals and the overall elapsed time
+*/
+int write_report(const char *path, thread_args_t *req_args[],
+                 int num_requesters, thread_args_t *res_args[],
+                 int num_resolvers, long long elapsed_ns);
+
 int main(int argc, char **argv);
 #endif
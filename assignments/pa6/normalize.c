@@ -0,0 +1,86 @@
+#include "normalize.h"
+#include <string.h>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// lowercase one byte, 0 if it is outside the hostname alphabet
+static inline int fold_char(char *c) {
+  if (*c >= 'A' && *c <= 'Z')
+    *c += 'a' - 'A';
+  return (*c >= 'a' && *c <= 'z') || (*c >= '0' && *c <= '9') || *c == '-' ||
+         *c == '.';
+}
+
+/* Lowercases name and checks every byte is in [a-z0-9.-]
+** SSE2 handles 16 bytes per step: bytes >= 0x80 compare as negative, so
+** they fall outside every range and are rejected with the rest
+*/
+static int fold_and_check(char *name, size_t len) {
+  size_t i = 0;
+
+#ifdef __SSE2__
+  const __m128i upper_lo = _mm_set1_epi8('A' - 1);
+  const __m128i upper_hi = _mm_set1_epi8('Z' + 1);
+  const __m128i lower_lo = _mm_set1_epi8('a' - 1);
+  const __m128i lower_hi = _mm_set1_epi8('z' + 1);
+  const __m128i digit_lo = _mm_set1_epi8('0' - 1);
+  const __m128i digit_hi = _mm_set1_epi8('9' + 1);
+  const __m128i hyphen = _mm_set1_epi8('-');
+  const __m128i dot = _mm_set1_epi8('.');
+  const __m128i case_bit = _mm_set1_epi8(0x20);
+
+  for (; i + 16 <= len; i += 16) {
+    __m128i c = _mm_loadu_si128((const __m128i *)(name + i));
+
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(c, upper_lo),
+                                  _mm_cmplt_epi8(c, upper_hi));
+    c = _mm_or_si128(c, _mm_and_si128(upper, case_bit));
+    _mm_storeu_si128((__m128i *)(name + i), c);
+
+    __m128i ok = _mm_and_si128(_mm_cmpgt_epi8(c, lower_lo),
+                               _mm_cmplt_epi8(c, lower_hi));
+    ok = _mm_or_si128(ok, _mm_and_si128(_mm_cmpgt_epi8(c, digit_lo),
+                                        _mm_cmplt_epi8(c, digit_hi)));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, hyphen));
+    ok = _mm_or_si128(ok, _mm_cmpeq_epi8(c, dot));
+    if (_mm_movemask_epi8(ok) != 0xffff)
+      return -1;
+  }
+#endif
+
+  for (; i < len; i++) {
+    if (!fold_char(&name[i]))
+      return -1;
+  }
+
+  return 0;
+}
+
+int hostname_normalize(char *name, size_t len) {
+  // one trailing root dot is allowed and does not count towards the limit
+  size_t body = len > 1 && name[len - 1] == '.' ? len - 1 : len;
+  if (body == 0 || body > MAX_HOSTNAME_LENGTH)
+    return -1;
+
+  if (fold_and_check(name, len) == -1)
+    return -1;
+
+  // labels are scanned dot to dot, memchr is vectorized by libc
+  const char *label = name;
+  const char *end = name + body;
+  while (label <= end) {
+    const char *next = memchr(label, '.', end - label);
+    if (next == NULL)
+      next = end;
+
+    size_t label_len = next - label;
+    if (label_len == 0 || label_len > MAX_LABEL_LENGTH || label[0] == '-' ||
+        next[-1] == '-')
+      return -1;
+
+    label = next + 1;
+  }
+
+  return 0;
+}
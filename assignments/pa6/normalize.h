@@ -0,0 +1,18 @@
+#ifndef NORMALIZE_H
+#define NORMALIZE_H
+
+#include <stddef.h>
+
+#define MAX_LABEL_LENGTH 63     // RFC 1035
+#define MAX_HOSTNAME_LENGTH 253 // RFC 1035, without the trailing root dot
+
+/* Lowercases name in place and checks it is a valid RFC 1123 hostname
+** Valid names use only letters, digits, '-' and '.', have labels of 1 - 63
+** characters that neither start nor end with '-', and may end in one
+** root dot
+** Returns 0 if the name is valid, -1 otherwise (an invalid name may be
+** left partly lowercased)
+*/
+int hostname_normalize(char *name, size_t len);
+
+#endif
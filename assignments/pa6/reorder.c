@@ -0,0 +1,162 @@
+#include "reorder.h"
+#include "arena.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static void heap_swap(reorder_entry_t *a, reorder_entry_t *b) {
+  reorder_entry_t tmp = *a;
+  *a = *b;
+  *b = tmp;
+}
+
+static int heap_push(reorder_t *r, const reorder_entry_t *entry) {
+  if (r->len == r->cap) {
+    size_t cap = r->cap ? r->cap * 2 : 1024;
+    reorder_entry_t *grown = realloc(r->heap, cap * sizeof(reorder_entry_t));
+    if (grown == NULL)
+      return -1;
+    r->heap = grown;
+    r->cap = cap;
+  }
+
+  size_t i = r->len++;
+  r->heap[i] = *entry;
+  while (i > 0 && r->heap[(i - 1) / 2].key > r->heap[i].key) {
+    heap_swap(&r->heap[(i - 1) / 2], &r->heap[i]);
+    i = (i - 1) / 2;
+  }
+  return 0;
+}
+
+static void heap_pop(reorder_t *r) {
+  r->heap[0] = r->heap[--r->len];
+  size_t i = 0;
+  for (;;) {
+    size_t min = i, l = 2 * i + 1, rt = 2 * i + 2;
+    if (l < r->len && r->heap[l].key < r->heap[min].key)
+      min = l;
+    if (rt < r->len && r->heap[rt].key < r->heap[min].key)
+      min = rt;
+    if (min == i)
+      break;
+    heap_swap(&r->heap[i], &r->heap[min]);
+    i = min;
+  }
+}
+
+static int write_top(reorder_t *r) {
+  reorder_entry_t *top = &r->heap[0];
+  int result = result_write(&r->out, top->host.name, top->ip);
+  arena_release(top->host.page);
+  heap_pop(r);
+  r->outstanding--;
+  return result;
+}
+
+// writes every result that is next in order, moving past finished files
+static int release(reorder_t *r) {
+  int result = 0;
+  size_t before = r->outstanding;
+
+  for (;;) {
+    if (r->len > 0 &&
+        r->heap[0].key == REORDER_KEY(r->head_file, r->head_line)) {
+      if (write_top(r) == -1)
+        result = -1;
+      r->head_line++;
+    } else if (r->head_file < r->num_files &&
+               r->counts[r->head_file] == (long)r->head_line) {
+      r->head_file++;
+      r->head_line = 0;
+    } else {
+      break;
+    }
+  }
+
+  if (r->outstanding != before)
+    pthread_cond_broadcast(&r->room);
+  return result;
+}
+
+int reorder_init(reorder_t *r, FILE *out, pthread_mutex_t *lock, int binary) {
+  memset(r, 0, sizeof(*r));
+  pthread_mutex_init(&r->lock, NULL);
+  pthread_cond_init(&r->room, NULL);
+  result_writer_init(&r->out, out, lock, binary);
+  return 0;
+}
+
+int reorder_finish(reorder_t *r) {
+  int result = 0;
+  while (r->len > 0) {
+    if (write_top(r) == -1)
+      result = -1;
+  }
+  if (result_flush(&r->out) == -1)
+    result = -1;
+
+  free(r->heap);
+  free(r->counts);
+  pthread_cond_destroy(&r->room);
+  pthread_mutex_destroy(&r->lock);
+  return result;
+}
+
+void reorder_admit(reorder_t *r, unsigned long long file) {
+  pthread_mutex_lock(&r->lock);
+  while (file != r->head_file && r->outstanding >= REORDER_CAPACITY) {
+    pthread_cond_wait(&r->room, &r->lock);
+  }
+  r->outstanding++;
+  pthread_mutex_unlock(&r->lock);
+}
+
+int reorder_put(reorder_t *r, const name_handle_t *host, const char *ip) {
+  reorder_entry_t entry;
+  entry.key = host->order;
+  entry.host = *host;
+  strncpy(entry.ip, ip, INET6_ADDRSTRLEN);
+  entry.ip[INET6_ADDRSTRLEN - 1] = '\0';
+
+  pthread_mutex_lock(&r->lock);
+  int result = heap_push(r, &entry);
+  if (result == -1) {
+    // out of memory: write it now, out of order, rather than lose it
+    fprintf(stderr, "Failed to allocate memory, result written unordered\n");
+    result_write(&r->out, host->name, entry.ip);
+    arena_release(host->page);
+    r->outstanding--;
+    pthread_cond_broadcast(&r->room);
+  } else {
+    result = release(r);
+  }
+  pthread_mutex_unlock(&r->lock);
+
+  return result;
+}
+
+void reorder_file_done(reorder_t *r, unsigned long long file, long count) {
+  pthread_mutex_lock(&r->lock);
+  if (file >= r->num_files) {
+    size_t num = r->num_files ? r->num_files : 64;
+    while (num <= file)
+      num *= 2;
+    long *grown = realloc(r->counts, num * sizeof(long));
+    if (grown == NULL) {
+      // the head cannot move past this file; its results are written by
+      // reorder_finish
+      fprintf(stderr, "Failed to allocate memory for output order\n");
+      pthread_mutex_unlock(&r->lock);
+      return;
+    }
+    for (size_t i = r->num_files; i < num; i++)
+      grown[i] = -1;
+    r->counts = grown;
+    r->num_files = num;
+  }
+
+  r->counts[file] = count;
+  release(r);
+  pthread_mutex_unlock(&r->lock);
+}
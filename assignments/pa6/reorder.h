@@ -0,0 +1,64 @@
+#ifndef REORDER_H
+#define REORDER_H
+
+#include "array.h"
+#include "results.h"
+#include <netinet/in.h> // for INET6_ADDRSTRLEN
+#include <pthread.h>
+
+#define REORDER_CAPACITY 16384 // results held back waiting for a gap to fill
+#define REORDER_FILE_BITS 32   // key: file sequence above, name within below
+
+// reorder key of the line-th name submitted from file
+#define REORDER_KEY(file, line)                                                \
+  ((unsigned long long)(file) << REORDER_FILE_BITS | (unsigned)(line))
+
+// a finished lookup waiting for the ones before it
+typedef struct {
+  unsigned long long key;
+  name_handle_t host; // its arena reference is held until written
+  char ip[INET6_ADDRSTRLEN];
+} reorder_entry_t;
+
+/* Reorder buffer for -o: results leave in input order
+** Every name that gets a result is keyed by its file's position in
+** file_store and its position among the file's submitted names. Resolvers
+** add results in any order and never wait; whatever is next in order is
+** written at once. Memory is bounded at the requesters: a name from any
+** file but the oldest unfinished one waits while REORDER_CAPACITY results
+** are outstanding. The oldest file is always being read (or done), so it
+** can always drain the buffer
+*/
+typedef struct {
+  pthread_mutex_t lock;
+  pthread_cond_t room;   // signalled when results are written
+  reorder_entry_t *heap; // min-heap on key
+  size_t len;
+  size_t cap;
+  long *counts;     // names per file, -1 until its requester finishes it
+  size_t num_files; // entries in counts
+  unsigned long long head_file; // oldest file with results still to write
+  unsigned head_line;           // next name of head_file to write
+  size_t outstanding;           // admitted names not yet written
+  result_writer_t out;
+} reorder_t;
+
+int reorder_init(reorder_t *r, FILE *out, pthread_mutex_t *lock, int binary);
+
+/* Writes what is still held (only possible after an error left a gap),
+** in key order, then flushes and frees the buffer
+*/
+int reorder_finish(reorder_t *r);
+
+// called once per name before it is submitted; blocks while the buffer is
+// full, unless the name belongs to the oldest unfinished file
+void reorder_admit(reorder_t *r, unsigned long long file);
+
+// adds the result for host (keyed by host->order) and writes all results
+// that are now in order; takes over host's arena reference
+int reorder_put(reorder_t *r, const name_handle_t *host, const char *ip);
+
+// records how many names file submitted once its requester is done with it
+void reorder_file_done(reorder_t *r, unsigned long long file, long count);
+
+#endif
@@ -0,0 +1,136 @@
+#include "results.h"
+#include <arpa/inet.h>
+#include <string.h>
+
+void result_writer_init(result_writer_t *w, FILE *out, pthread_mutex_t *lock,
+                        int binary) {
+  w->out = out;
+  w->lock = lock;
+  w->binary = binary;
+  w->len = 0;
+}
+
+int result_flush(result_writer_t *w) {
+  if (w->len == 0)
+    return 0;
+
+  if (w->lock != NULL)
+    pthread_mutex_lock(w->lock);
+  size_t written = fwrite(w->buf, 1, w->len, w->out);
+  if (w->lock != NULL)
+    pthread_mutex_unlock(w->lock);
+
+  int result = written == w->len ? 0 : -1;
+  w->len = 0;
+  return result;
+}
+
+// encode one record at the end of the writer's buffer
+static int encode(result_writer_t *w, const char *host, const char *ip) {
+  unsigned char addr[sizeof(struct in6_addr)];
+  result_status_t status = RESULT_RESOLVED;
+  result_family_t family = RESULT_NONE;
+  size_t addr_len = 0;
+
+  if (inet_pton(AF_INET, ip, addr) == 1) {
+    family = RESULT_INET;
+    addr_len = 4;
+  } else if (inet_pton(AF_INET6, ip, addr) == 1) {
+    family = RESULT_INET6;
+    addr_len = 16;
+  } else if (strcmp(ip, NOT_RESOLVED_TEXT) == 0) {
+    status = RESULT_NOT_RESOLVED;
+  } else {
+    status = RESULT_UNHANDLED;
+  }
+
+  size_t name_len = strlen(host);
+  if (name_len >= RESULTS_NAME_LENGTH)
+    return -1;
+
+  size_t need = 4 + name_len + addr_len;
+  if (w->len + need > RESULTS_BUFFER_SIZE && result_flush(w) == -1)
+    return -1;
+
+  unsigned char *rec = w->buf + w->len;
+  rec[0] = status;
+  rec[1] = family;
+  rec[2] = name_len & 0xff;
+  rec[3] = name_len >> 8;
+  memcpy(rec + 4, host, name_len);
+  memcpy(rec + 4 + name_len, addr, addr_len);
+  w->len += need;
+
+  return 0;
+}
+
+int result_write(result_writer_t *w, const char *host, const char *ip) {
+  if (w->binary)
+    return encode(w, host, ip);
+
+  if (w->lock != NULL)
+    pthread_mutex_lock(w->lock);
+  int written = fprintf(w->out, "%s, %s\n", host, ip);
+  if (w->lock != NULL)
+    pthread_mutex_unlock(w->lock);
+
+  return written < 0 ? -1 : 0;
+}
+
+int results_write_header(FILE *out) {
+  unsigned char header[RESULTS_HEADER_SIZE] = {0};
+  memcpy(header, RESULTS_MAGIC, 4);
+  header[4] = RESULTS_VERSION & 0xff;
+  header[5] = RESULTS_VERSION >> 8;
+
+  return fwrite(header, 1, sizeof(header), out) == sizeof(header) ? 0 : -1;
+}
+
+int results_read_header(FILE *in) {
+  unsigned char header[RESULTS_HEADER_SIZE];
+  if (fread(header, 1, sizeof(header), in) != sizeof(header) ||
+      memcmp(header, RESULTS_MAGIC, 4) != 0)
+    return -1;
+
+  int version = header[4] | header[5] << 8;
+  return version == RESULTS_VERSION ? 0 : -1;
+}
+
+int result_read(FILE *in, char host[RESULTS_NAME_LENGTH],
+                char ip[INET6_ADDRSTRLEN]) {
+  unsigned char rec[4];
+  size_t got = fread(rec, 1, sizeof(rec), in);
+  if (got == 0 && feof(in))
+    return 0;
+  if (got != sizeof(rec))
+    return -1; // truncated record
+
+  size_t name_len = rec[2] | rec[3] << 8;
+  if (name_len >= RESULTS_NAME_LENGTH ||
+      fread(host, 1, name_len, in) != name_len)
+    return -1;
+  host[name_len] = '\0';
+
+  unsigned char addr[sizeof(struct in6_addr)];
+  switch (rec[0]) {
+  case RESULT_RESOLVED: {
+    int af = rec[1] == RESULT_INET ? AF_INET : AF_INET6;
+    size_t addr_len = rec[1] == RESULT_INET ? 4 : 16;
+    if ((rec[1] != RESULT_INET && rec[1] != RESULT_INET6) ||
+        fread(addr, 1, addr_len, in) != addr_len ||
+        inet_ntop(af, addr, ip, INET6_ADDRSTRLEN) == NULL)
+      return -1;
+    break;
+  }
+  case RESULT_NOT_RESOLVED:
+    strcpy(ip, NOT_RESOLVED_TEXT);
+    break;
+  case RESULT_UNHANDLED:
+    strcpy(ip, UNHANDLED_TEXT);
+    break;
+  default:
+    return -1;
+  }
+
+  return 1;
+}
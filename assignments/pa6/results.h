@@ -0,0 +1,63 @@
+#ifndef RESULTS_H
+#define RESULTS_H
+
+#include <netinet/in.h> // for INET6_ADDRSTRLEN
+#include <pthread.h>
+#include <stdio.h>
+
+#define RESULTS_MAGIC "MLRB"
+#define RESULTS_VERSION 1
+#define RESULTS_HEADER_SIZE 8            // magic, u16 version, u16 reserved
+#define RESULTS_BUFFER_SIZE (64 * 1024)  // per-writer binary buffer
+#define RESULTS_NAME_LENGTH 256          // longest DNS name (253) + \0
+#define NOT_RESOLVED_TEXT "NOT_RESOLVED" // same text the resolver log uses
+#define UNHANDLED_TEXT "UNHANDELED"     // spelled as dnslookup writes it
+
+/* Binary results file: header, then one record per result
+** record: u8 status, u8 family, u16 name length (little endian), name bytes
+** (no \0), then 4 (RESULT_INET) or 16 (RESULT_INET6) address bytes
+*/
+typedef enum {
+  RESULT_RESOLVED = 0,
+  RESULT_NOT_RESOLVED = 1, // lookup failed
+  RESULT_UNHANDLED = 2,    // first address was not IPv4
+} result_status_t;
+
+typedef enum {
+  RESULT_NONE = 0, // no address follows
+  RESULT_INET = 4,
+  RESULT_INET6 = 6,
+} result_family_t;
+
+// where one thread's results go, text lines or buffered binary records
+typedef struct {
+  FILE *out;
+  pthread_mutex_t *lock; // guards out, NULL when only one thread writes
+  int binary;
+  size_t len; // bytes buffered, binary only
+  unsigned char buf[RESULTS_BUFFER_SIZE];
+} result_writer_t;
+
+void result_writer_init(result_writer_t *w, FILE *out, pthread_mutex_t *lock,
+                        int binary);
+
+/* Writes one (hostname, IP) result
+** Text results are written as a "host, ip" line right away; binary records
+** collect in the writer's buffer and go out in one fwrite when it fills
+*/
+int result_write(result_writer_t *w, const char *host, const char *ip);
+
+// writes out whatever the writer has buffered
+int result_flush(result_writer_t *w);
+
+int results_write_header(FILE *out);
+int results_read_header(FILE *in);
+
+/* Reads the next binary record and formats it as the text log would
+** Returns 1 with host and ip filled in, 0 at end of file, -1 if the
+** record is malformed
+*/
+int result_read(FILE *in, char host[RESULTS_NAME_LENGTH],
+                char ip[INET6_ADDRSTRLEN]);
+
+#endif
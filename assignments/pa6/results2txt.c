@@ -0,0 +1,63 @@
+/* Converts a binary resolver log (multi-lookup -b) back to text
+**
+** Streams records from <results> (or stdin) and writes the "host, ip" lines
+** multi-lookup would have written without -b, so existing consumers of the
+** text log keep working.
+*/
+#include "results.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define IO_BUFFER_SIZE (1 << 20)
+
+const char *usage = "usage: results2txt [<binary results> [<text results>]]\n";
+
+int main(int argc, char **argv) {
+  if (argc > 3 || (argc > 1 && strcmp(argv[1], "-h") == 0)) {
+    fprintf(stderr, "%s", usage);
+    return EXIT_FAILURE;
+  }
+
+  FILE *in = argc > 1 ? fopen(argv[1], "rb") : stdin;
+  if (in == NULL) {
+    fprintf(stderr, "Invalid file: %s\n", argv[1]);
+    return EXIT_FAILURE;
+  }
+  FILE *out = argc > 2 ? fopen(argv[2], "w") : stdout;
+  if (out == NULL) {
+    fprintf(stderr, "Invalid file: %s\n", argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  // large sequential reads and writes, records are tiny
+  setvbuf(in, NULL, _IOFBF, IO_BUFFER_SIZE);
+  setvbuf(out, NULL, _IOFBF, IO_BUFFER_SIZE);
+
+  if (results_read_header(in) == -1) {
+    fprintf(stderr, "Not a binary results file\n");
+    return EXIT_FAILURE;
+  }
+
+  char host[RESULTS_NAME_LENGTH];
+  char ip[INET6_ADDRSTRLEN];
+  long records = 0;
+  int got;
+  while ((got = result_read(in, host, ip)) == 1) {
+    fprintf(out, "%s, %s\n", host, ip);
+    records++;
+  }
+
+  int status = EXIT_SUCCESS;
+  if (got == -1) {
+    fprintf(stderr, "Malformed record after %ld records\n", records);
+    status = EXIT_FAILURE;
+  }
+  if (fclose(out) == EOF) {
+    fprintf(stderr, "Error writing results\n");
+    status = EXIT_FAILURE;
+  }
+  fclose(in);
+
+  return status;
+}
@@ -0,0 +1,272 @@
+#include "scan.h"
+#include <dirent.h> // for DT_* entry types
+#include <fcntl.h>
+#include <glob.h>
+#include <limits.h> // for PATH_MAX
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// record layout returned by getdents64
+struct linux_dirent64 {
+  unsigned long long d_ino;
+  long long d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+// put one data file name into file_store, copying it into arena unless
+// the caller guarantees it outlives the requesters
+static int put_file(scanner_t *scan, arena_t *arena, const char *path,
+                    int stable) {
+  name_handle_t entry;
+  memset(&entry, 0, sizeof(entry));
+  size_t len = strlen(path);
+
+  if (stable) {
+    entry.name = path;
+    entry.len = len;
+  } else {
+    char *copy = arena_reserve(arena, len + 1);
+    if (copy == NULL)
+      return -1;
+    memcpy(copy, path, len + 1);
+    arena_commit(arena, len + 1, &entry);
+  }
+
+  if (array_put(scan->file_store, &entry) == -1) {
+    arena_release(entry.page);
+    return -1;
+  }
+  return 0;
+}
+
+static int queue_dir(scanner_t *scan, const char *path) {
+  size_t len = strlen(path);
+  scan_dir_t *dir = malloc(sizeof(scan_dir_t) + len + 1);
+  if (dir == NULL) {
+    fprintf(stderr, "Error allocating memory for directory\n");
+    return -1;
+  }
+  memcpy(dir->path, path, len + 1);
+
+  pthread_mutex_lock(&scan->lock);
+  dir->next = scan->dirs;
+  scan->dirs = dir;
+  scan->pending++;
+  pthread_cond_signal(&scan->cond);
+  pthread_mutex_unlock(&scan->lock);
+
+  return 0;
+}
+
+/* Lists one directory with getdents64
+** Subdirectories are queued for any scanner, regular files go straight to
+** file_store. Symlinks are followed to files only, so a link back up the
+** tree cannot make the walk loop
+*/
+static void scan_dir(scanner_t *scan, arena_t *arena, char *buf,
+                     const char *path) {
+  int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd == -1) {
+    fprintf(stderr, "Invalid directory: %s\n", path);
+    return;
+  }
+
+  char child[PATH_MAX];
+  size_t base = strlen(path);
+  if (base + 2 > sizeof(child)) {
+    fprintf(stderr, "Path too long: %s\n", path);
+    close(fd);
+    return;
+  }
+  memcpy(child, path, base);
+  if (base == 0 || child[base - 1] != '/')
+    child[base++] = '/';
+
+  long n;
+  while ((n = syscall(SYS_getdents64, fd, buf, SCAN_BUFFER_SIZE)) > 0) {
+    for (long off = 0; off < n;) {
+      struct linux_dirent64 *d = (struct linux_dirent64 *)(buf + off);
+      off += d->d_reclen;
+
+      const char *name = d->d_name;
+      if (strcmp(name, ".") == 0 || strcmp(name, "..") == 0)
+        continue;
+
+      size_t len = strlen(name);
+      if (base + len + 1 > sizeof(child)) {
+        fprintf(stderr, "Path too long: %.*s%s\n", (int)base, child, name);
+        continue;
+      }
+      memcpy(child + base, name, len + 1);
+
+      // some filesystems leave the type to a stat
+      unsigned char type = d->d_type;
+      struct stat st;
+      if (type == DT_UNKNOWN) {
+        if (fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == -1)
+          continue; // gone since listing
+        type = S_ISDIR(st.st_mode)   ? DT_DIR
+               : S_ISLNK(st.st_mode) ? DT_LNK
+               : S_ISREG(st.st_mode) ? DT_REG
+                                     : DT_UNKNOWN;
+      }
+      if (type == DT_LNK) {
+        if (fstatat(fd, name, &st, 0) == -1)
+          continue; // dangling link
+        type = S_ISREG(st.st_mode) ? DT_REG : DT_UNKNOWN;
+      }
+
+      if (type == DT_DIR) {
+        queue_dir(scan, child);
+      } else if (type == DT_REG && put_file(scan, arena, child, 0) == -1) {
+        fprintf(stderr, "Failed to write to shared array\n");
+      }
+    }
+  }
+  if (n < 0) {
+    fprintf(stderr, "Error reading directory: %s\n", path);
+  }
+
+  close(fd);
+}
+
+static void *scanner(void *arg) {
+  scanner_t *scan = arg;
+  arena_t arena; // holds the names this scanner finds
+  arena_init(&arena);
+
+  char *buf = malloc(SCAN_BUFFER_SIZE);
+  if (buf == NULL) {
+    fprintf(stderr, "Error allocating memory for scanner\n");
+  }
+
+  while (buf != NULL) {
+    pthread_mutex_lock(&scan->lock);
+    while (scan->dirs == NULL && !(scan->closed && scan->pending == 0)) {
+      pthread_cond_wait(&scan->cond, &scan->lock);
+    }
+    scan_dir_t *dir = scan->dirs;
+    if (dir != NULL)
+      scan->dirs = dir->next;
+    pthread_mutex_unlock(&scan->lock);
+
+    if (dir == NULL)
+      break; // closed and nothing left anywhere
+
+    scan_dir(scan, &arena, buf, dir->path);
+    free(dir);
+
+    // subdirectories were queued before this one is counted done
+    pthread_mutex_lock(&scan->lock);
+    if (--scan->pending == 0)
+      pthread_cond_broadcast(&scan->cond);
+    pthread_mutex_unlock(&scan->lock);
+  }
+
+  free(buf);
+  arena_free(&arena);
+  return NULL;
+}
+
+int scanner_start(scanner_t *scan, array *file_store, int num_threads) {
+  scan->file_store = file_store;
+  scan->dirs = NULL;
+  scan->pending = 0;
+  scan->closed = 0;
+  scan->num_threads = 0;
+  pthread_mutex_init(&scan->lock, NULL);
+  pthread_cond_init(&scan->cond, NULL);
+  arena_init(&scan->arena);
+
+  for (int i = 0; i < num_threads; i++) {
+    if (pthread_create(&scan->threads[i], NULL, scanner, scan) != 0) {
+      fprintf(stderr, "Failed to create thread\n");
+      scanner_finish(scan);
+      return -1;
+    }
+    scan->num_threads++;
+  }
+
+  return 0;
+}
+
+// a single path: directories go to the scanners, anything else is a file
+static int add_path(scanner_t *scan, const char *path, int stable) {
+  struct stat st;
+  if (stat(path, &st) == 0 && S_ISDIR(st.st_mode))
+    return queue_dir(scan, path);
+
+  // missing files are still queued, the requester reports them
+  return put_file(scan, &scan->arena, path, stable);
+}
+
+int scanner_add(scanner_t *scan, const char *input, int stable) {
+  struct stat st;
+  if (strpbrk(input, "*?[") == NULL || stat(input, &st) == 0)
+    return add_path(scan, input, stable);
+
+  glob_t matches;
+  int rc = glob(input, 0, NULL, &matches);
+  if (rc == GLOB_NOMATCH) {
+    fprintf(stderr, "No files match: %s\n", input);
+    return 0;
+  }
+  if (rc != 0) {
+    fprintf(stderr, "Invalid pattern: %s\n", input);
+    return 0;
+  }
+
+  int result = 0;
+  for (size_t i = 0; i < matches.gl_pathc && result == 0; i++) {
+    result = add_path(scan, matches.gl_pathv[i], 0);
+  }
+  globfree(&matches);
+
+  return result;
+}
+
+int scanner_add_manifest(scanner_t *scan, const char *path) {
+  FILE *manifest = strcmp(path, "-") == 0 ? stdin : fopen(path, "r");
+  if (manifest == NULL) {
+    fprintf(stderr, "Invalid file: %s\n", path);
+    return -1;
+  }
+
+  int result = 0;
+  char *line = NULL;
+  size_t cap = 0;
+  ssize_t len;
+  while (result == 0 && (len = getline(&line, &cap, manifest)) != -1) {
+    line[strcspn(line, "\n")] = '\0';
+    if (line[0] == '\0')
+      continue;
+    result = scanner_add(scan, line, 0);
+  }
+  free(line);
+
+  if (manifest != stdin)
+    fclose(manifest);
+  return result;
+}
+
+void scanner_finish(scanner_t *scan) {
+  pthread_mutex_lock(&scan->lock);
+  scan->closed = 1;
+  pthread_cond_broadcast(&scan->cond);
+  pthread_mutex_unlock(&scan->lock);
+
+  for (int i = 0; i < scan->num_threads; i++) {
+    pthread_join(scan->threads[i], NULL);
+  }
+
+  // every directory queued so far has been scanned by now
+  arena_free(&scan->arena);
+  pthread_mutex_destroy(&scan->lock);
+  pthread_cond_destroy(&scan->cond);
+}
@@ -0,0 +1,53 @@
+#ifndef SCAN_H
+#define SCAN_H
+
+#include "arena.h"
+#include "array.h"
+#include <pthread.h>
+
+#define SCAN_BUFFER_SIZE (64 * 1024) // bytes of directory entries per getdents
+#define DEFAULT_SCANNERS 2
+#define MAX_SCANNERS 64
+
+// a directory waiting to be scanned
+typedef struct scan_dir {
+  struct scan_dir *next;
+  char path[];
+} scan_dir_t;
+
+/* Streams data file names into file_store as they are discovered
+** Inputs may be files, directories (walked recursively by the scanner
+** threads) or glob patterns; names found by a scanner live in its arena and
+** are released by the requester once the file has been read
+*/
+typedef struct {
+  array *file_store;
+  scan_dir_t *dirs; // directories not yet picked up by a scanner
+  int pending;      // directories queued or being scanned
+  int closed;       // no more inputs will be added
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  pthread_t threads[MAX_SCANNERS];
+  int num_threads;
+  arena_t arena; // names copied by the thread adding inputs
+} scanner_t;
+
+// starts num_threads scanner threads, idle until directories are added
+int scanner_start(scanner_t *scan, array *file_store, int num_threads);
+
+/* Adds one input
+** - a glob pattern is expanded and each match added in turn
+** - a directory is queued for the scanner threads
+** - anything else is put into file_store as a data file
+** Names not marked stable are copied, stable ones are queued in place
+*/
+int scanner_add(scanner_t *scan, const char *input, int stable);
+
+// adds every line of a manifest file ("-" reads stdin) as an input
+int scanner_add_manifest(scanner_t *scan, const char *path);
+
+// waits until every queued directory has been scanned, then stops the
+// scanner threads
+void scanner_finish(scanner_t *scan);
+
+#endif
@@ -0,0 +1,136 @@
+#include "stats.h"
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+
+static const char *stage_names[NUM_STAGES] = {
+    "file_read", "enqueue_wait", "queue_residence", "lookup", "output_write"};
+
+long long stats_now_ns(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000000LL + now.tv_nsec;
+}
+
+// map a value onto its log-linear bucket
+static int hist_index(long long value) {
+  unsigned long long v = (unsigned long long)value;
+  if (v < HIST_SUB_BUCKETS)
+    return (int)v; // exact buckets for tiny values
+
+  int msb = 63 - __builtin_clzll(v);
+  int shift = msb - HIST_SUB_BUCKET_BITS;
+  int sub = (int)(v >> shift) - HIST_SUB_BUCKETS; // 0 .. SUB_BUCKETS - 1
+  return HIST_SUB_BUCKETS + shift * HIST_SUB_BUCKETS + sub;
+}
+
+// largest value that maps onto bucket idx
+static long long hist_upper(int idx) {
+  if (idx < HIST_SUB_BUCKETS)
+    return idx;
+
+  int shift = (idx - HIST_SUB_BUCKETS) / HIST_SUB_BUCKETS;
+  int sub = (idx - HIST_SUB_BUCKETS) % HIST_SUB_BUCKETS;
+  return ((long long)(HIST_SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void hist_init(hist_t *h) {
+  memset(h->counts, 0, sizeof(h->counts));
+  h->total = 0;
+  h->min = LLONG_MAX;
+  h->max = 0;
+  h->sum = 0;
+}
+
+void hist_record(hist_t *h, long long value_ns) {
+  if (value_ns < 0)
+    value_ns = 0; // clock granularity can produce tiny negative deltas
+
+  h->counts[hist_index(value_ns)]++;
+  h->total++;
+  h->sum += value_ns;
+  if (value_ns < h->min)
+    h->min = value_ns;
+  if (value_ns > h->max)
+    h->max = value_ns;
+}
+
+void hist_merge(hist_t *dst, const hist_t *src) {
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    dst->counts[i] += src->counts[i];
+  }
+  dst->total += src->total;
+  dst->sum += src->sum;
+  if (src->min < dst->min)
+    dst->min = src->min;
+  if (src->max > dst->max)
+    dst->max = src->max;
+}
+
+long long hist_percentile(const hist_t *h, double fraction) {
+  if (h->total == 0)
+    return 0;
+
+  // rank of the sample we are after, rounded up
+  double rank = fraction * h->total;
+  unsigned long long target = (unsigned long long)rank;
+  if (target < rank || target == 0)
+    target++;
+
+  unsigned long long seen = 0;
+  for (int i = 0; i < HIST_BUCKETS; i++) {
+    seen += h->counts[i];
+    if (seen >= target) {
+      long long upper = hist_upper(i);
+      // bucket bounds may overshoot what was actually recorded
+      return upper > h->max ? h->max : upper;
+    }
+  }
+
+  return h->max;
+}
+
+void stage_stats_init(stage_stats_t *s) {
+  for (int i = 0; i < NUM_STAGES; i++) {
+    hist_init(&s->hist[i]);
+  }
+}
+
+void stage_stats_merge(stage_stats_t *dst, const stage_stats_t *src) {
+  for (int i = 0; i < NUM_STAGES; i++) {
+    hist_merge(&dst->hist[i], &src->hist[i]);
+  }
+}
+
+const char *stage_name(stage_t stage) { return stage_names[stage]; }
+
+void stats_write_json(FILE *out, const stage_stats_t *s) {
+  fprintf(out, "{");
+  for (int i = 0; i < NUM_STAGES; i++) {
+    const hist_t *h = &s->hist[i];
+
+    fprintf(out, "%s\n    \"%s\": {", i ? "," : "", stage_names[i]);
+    fprintf(out, "\"count\": %llu, ", h->total);
+    fprintf(out, "\"min_ns\": %lld, ", h->total ? h->min : 0);
+    fprintf(out, "\"mean_ns\": %lld, ",
+            h->total ? h->sum / (long long)h->total : 0);
+    fprintf(out, "\"p50_ns\": %lld, ", hist_percentile(h, 0.50));
+    fprintf(out, "\"p90_ns\": %lld, ", hist_percentile(h, 0.90));
+    fprintf(out, "\"p99_ns\": %lld, ", hist_percentile(h, 0.99));
+    fprintf(out, "\"p999_ns\": %lld, ", hist_percentile(h, 0.999));
+    fprintf(out, "\"max_ns\": %lld, ", h->max);
+
+    // sparse bucket dump so the full distribution can be re-plotted
+    fprintf(out, "\"buckets\": [");
+    int first = 1;
+    for (int b = 0; b < HIST_BUCKETS; b++) {
+      if (h->counts[b] == 0)
+        continue;
+      fprintf(out, "%s[%lld, %llu]", first ? "" : ", ", hist_upper(b),
+              h->counts[b]);
+      first = 0;
+    }
+    fprintf(out, "]}");
+  }
+  fprintf(out, "\n  }");
+}
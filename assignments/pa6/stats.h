@@ -0,0 +1,72 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdio.h>
+
+// HDR-style log-linear histogram: each power of two is split into
+// HIST_SUB_BUCKETS linear buckets, so any recorded value is reported within
+// ~1/HIST_SUB_BUCKETS (6%) of its true value across the full ns range
+#define HIST_SUB_BUCKET_BITS 4
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BUCKET_BITS)
+#define HIST_MAGNITUDES 60 // enough shifts for any positive long long
+#define HIST_BUCKETS ((HIST_MAGNITUDES + 1) * HIST_SUB_BUCKETS)
+
+typedef struct {
+  unsigned long long counts[HIST_BUCKETS];
+  unsigned long long total; // number of recorded values
+  long long min;
+  long long max;
+  long long sum;
+} hist_t;
+
+// pipeline stages timed by requesters and resolvers
+typedef enum {
+  STAGE_FILE_READ,       // fopen / fgets / fclose per input file
+  STAGE_ENQUEUE_WAIT,    // time blocked in array_put on host_store
+  STAGE_QUEUE_RESIDENCE, // time a hostname spent inside host_store
+  STAGE_LOOKUP,          // dnslookup per hostname
+  STAGE_OUTPUT_WRITE,    // lock + write of serviced / results lines
+  NUM_STAGES
+} stage_t;
+
+// one per thread, merged by main once the thread has been joined
+typedef struct {
+  hist_t hist[NUM_STAGES];
+} stage_stats_t;
+
+long long stats_now_ns(void);
+
+// per-thread counters have one writer but may be sampled by the metrics
+// thread while it runs, so both sides use relaxed atomics (plain moves on
+// x86, no locked increment)
+static inline void counter_inc(int *c) {
+  __atomic_store_n(c, __atomic_load_n(c, __ATOMIC_RELAXED) + 1,
+                   __ATOMIC_RELAXED);
+}
+
+static inline void counter_set(int *c, int value) {
+  __atomic_store_n(c, value, __ATOMIC_RELAXED);
+}
+
+static inline int counter_read(const int *c) {
+  return __atomic_load_n(c, __ATOMIC_RELAXED);
+}
+
+void hist_init(hist_t *h);
+void hist_record(hist_t *h, long long value_ns);
+void hist_merge(hist_t *dst, const hist_t *src);
+// value at or below which the given fraction (0.0 - 1.0) of samples fall
+long long hist_percentile(const hist_t *h, double fraction);
+
+void stage_stats_init(stage_stats_t *s);
+void stage_stats_merge(stage_stats_t *dst, const stage_stats_t *src);
+const char *stage_name(stage_t stage);
+
+/* Writes the merged per-stage histograms as a JSON object to out
+** Functionality:
+** - one entry per stage with count, min, mean, max and percentiles
+** - non-empty buckets as [upper bound ns, count] pairs
+*/
+void stats_write_json(FILE *out, const stage_stats_t *s);
+
+#endif
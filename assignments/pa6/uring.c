@@ -0,0 +1,121 @@
+#include "uring.h"
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+static int sys_setup(unsigned entries, struct io_uring_params *p) {
+  return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int sys_enter(int fd, unsigned to_submit, unsigned min_complete,
+                     unsigned flags) {
+  return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags,
+                      NULL, 0);
+}
+
+int uring_init(uring_t *ring, unsigned entries) {
+  struct io_uring_params p;
+  memset(ring, 0, sizeof(*ring));
+  memset(&p, 0, sizeof(p));
+
+  ring->fd = sys_setup(entries, &p);
+  if (ring->fd < 0)
+    return -1;
+  ring->entries = p.sq_entries;
+
+  ring->sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+  ring->cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+  ring->sq_ptr = mmap(NULL, ring->sq_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ptr = mmap(NULL, ring->cq_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes = mmap(NULL, ring->sqes_len, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+  if (ring->sq_ptr == MAP_FAILED || ring->cq_ptr == MAP_FAILED ||
+      ring->sqes == MAP_FAILED) {
+    if (ring->sq_ptr != MAP_FAILED)
+      munmap(ring->sq_ptr, ring->sq_len);
+    if (ring->cq_ptr != MAP_FAILED)
+      munmap(ring->cq_ptr, ring->cq_len);
+    if (ring->sqes != MAP_FAILED)
+      munmap(ring->sqes, ring->sqes_len);
+    close(ring->fd);
+    return -1;
+  }
+
+  char *sq = ring->sq_ptr;
+  ring->sq_head = (unsigned *)(sq + p.sq_off.head);
+  ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+  ring->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+  ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+
+  char *cq = ring->cq_ptr;
+  ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+  ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+  ring->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+
+  return 0;
+}
+
+void uring_exit(uring_t *ring) {
+  munmap(ring->sqes, ring->sqes_len);
+  munmap(ring->cq_ptr, ring->cq_len);
+  munmap(ring->sq_ptr, ring->sq_len);
+  close(ring->fd);
+}
+
+struct io_uring_sqe *uring_get_sqe(uring_t *ring) {
+  unsigned head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+  unsigned tail = *ring->sq_tail;
+  if (tail - head >= ring->entries) {
+    // full: hand what is queued to the kernel, which frees its entries
+    if (uring_submit_and_wait(ring, 0) == -1)
+      return NULL;
+    head = __atomic_load_n(ring->sq_head, __ATOMIC_ACQUIRE);
+    if (tail - head >= ring->entries)
+      return NULL;
+  }
+
+  unsigned idx = tail & *ring->sq_mask;
+  struct io_uring_sqe *sqe = &ring->sqes[idx];
+  memset(sqe, 0, sizeof(*sqe));
+  ring->sq_array[idx] = idx;
+
+  // publish the entry to the kernel
+  __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+  ring->to_submit++;
+
+  return sqe;
+}
+
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr) {
+  unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+  int ret;
+  do {
+    ret = sys_enter(ring->fd, ring->to_submit, wait_nr, flags);
+  } while (ret < 0 && errno == EINTR);
+
+  if (ret < 0)
+    return -1;
+
+  unsigned done = (unsigned)ret;
+  ring->to_submit -= done < ring->to_submit ? done : ring->to_submit;
+  return 0;
+}
+
+int uring_pop_cqe(uring_t *ring, struct io_uring_cqe *cqe) {
+  unsigned head = *ring->cq_head;
+  unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+  if (head == tail)
+    return -1;
+
+  *cqe = ring->cqes[head & *ring->cq_mask];
+  __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+
+  return 0;
+}
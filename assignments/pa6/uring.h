@@ -0,0 +1,45 @@
+#ifndef URING_H
+#define URING_H
+
+#include <linux/io_uring.h>
+#include <stddef.h>
+
+// minimal io_uring wrapper over the raw syscalls (no liburing dependency)
+typedef struct {
+  int fd;
+  unsigned entries;
+  // submission ring
+  unsigned *sq_head;
+  unsigned *sq_tail;
+  unsigned *sq_mask;
+  unsigned *sq_array;
+  struct io_uring_sqe *sqes;
+  unsigned to_submit; // sqes filled since the last io_uring_enter
+  // completion ring
+  unsigned *cq_head;
+  unsigned *cq_tail;
+  unsigned *cq_mask;
+  struct io_uring_cqe *cqes;
+  // mappings, for teardown
+  void *sq_ptr;
+  size_t sq_len;
+  void *cq_ptr;
+  size_t cq_len;
+  size_t sqes_len;
+} uring_t;
+
+// returns -1 when the kernel (or a sandbox) does not allow io_uring
+int uring_init(uring_t *ring, unsigned entries);
+void uring_exit(uring_t *ring);
+
+// next free submission entry (zeroed); a full ring is submitted first,
+// NULL only if that fails or frees nothing
+struct io_uring_sqe *uring_get_sqe(uring_t *ring);
+
+// submits queued entries and waits for at least wait_nr completions
+int uring_submit_and_wait(uring_t *ring, unsigned wait_nr);
+
+// pops one completion into *cqe, returns -1 if none is ready
+int uring_pop_cqe(uring_t *ring, struct io_uring_cqe *cqe);
+
+#endif
@@ -0,0 +1,310 @@
+#include "workers.h"
+#include "stats.h"
+#include "util.h"
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+// body of a worker process: answer requests until told to quit
+static void worker_main(worker_shared_t *shm, worker_ring_t *ring) {
+  for (;;) {
+    while (sem_wait(&ring->requests) == -1) {
+      if (errno != EINTR)
+        _exit(EXIT_FAILURE);
+    }
+    worker_request_t *req = &ring->req[ring->req_tail++ % WORKER_SLOTS];
+    if (req->id == WORKER_QUIT)
+      _exit(EXIT_SUCCESS);
+
+    worker_response_t *res = &ring->res[ring->res_head % WORKER_SLOTS];
+    res->id = req->id;
+    res->resolved =
+        dnslookup(req->name, res->ip, sizeof(res->ip)) != UTIL_FAILURE;
+    __atomic_store_n(&ring->res_head, ring->res_head + 1, __ATOMIC_RELEASE);
+    sem_post(&shm->responses);
+  }
+}
+
+static void reset_requests(worker_ring_t *ring) {
+  sem_init(&ring->requests, WORKER_PSHARED, 0);
+  ring->req_head = 0;
+  ring->req_tail = 0;
+}
+
+static int fork_worker(worker_pool_t *pool, int w) {
+  pid_t parent = getpid();
+  pid_t pid = fork();
+  if (pid == -1) {
+    fprintf(stderr, "Failed to fork resolver worker\n");
+    return -1;
+  }
+
+  if (pid == 0) {
+    // a worker must not outlive the thread that feeds it
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+    if (getppid() != parent)
+      _exit(EXIT_FAILURE);
+    worker_main(pool->shm, &pool->shm->rings[w]);
+  }
+
+  pool->pids[w] = pid;
+  return 0;
+}
+
+static void send_request(worker_pool_t *pool, int w, uint32_t id,
+                         const char *name, size_t len) {
+  worker_ring_t *ring = &pool->shm->rings[w];
+  worker_request_t *req = &ring->req[ring->req_head++ % WORKER_SLOTS];
+  req->id = id;
+  memcpy(req->name, name, len + 1);
+  sem_post(&ring->requests);
+}
+
+// answers a job on behalf of a dead worker, as if it had failed the lookup
+static void fail_job(worker_pool_t *pool, int w, uint32_t id) {
+  worker_ring_t *ring = &pool->shm->rings[w];
+  worker_response_t *res = &ring->res[ring->res_head % WORKER_SLOTS];
+  res->id = id;
+  res->resolved = 0;
+  __atomic_store_n(&ring->res_head, ring->res_head + 1, __ATOMIC_RELEASE);
+  sem_post(&pool->shm->responses);
+}
+
+// whether the response ring of w already holds an answer for id
+static int answered(worker_ring_t *ring, uint32_t id) {
+  unsigned head = __atomic_load_n(&ring->res_head, __ATOMIC_ACQUIRE);
+  for (unsigned i = ring->res_tail; i != head; i++) {
+    if (ring->res[i % WORKER_SLOTS].id == id)
+      return 1;
+  }
+  return 0;
+}
+
+/* Replaces worker w after it died
+** Answers already in its response ring are kept, every other lookup it
+** held is queued again for the new worker, or failed once it has seen
+** WORKER_ATTEMPTS crashes. Nothing writes the rings of w until the new
+** worker is forked, so the requests are queued (and failures appended)
+** before the fork; if the fork fails, the queued lookups fail too
+*/
+static void respawn(worker_pool_t *pool, int w, int status) {
+  worker_ring_t *ring = &pool->shm->rings[w];
+  if (WIFSIGNALED(status)) {
+    fprintf(stderr, "Resolver worker %d killed by signal %d\n",
+            (int)pool->pids[w], WTERMSIG(status));
+  } else {
+    fprintf(stderr, "Resolver worker %d exited with status %d\n",
+            (int)pool->pids[w], WEXITSTATUS(status));
+  }
+
+  sem_destroy(&ring->requests);
+  reset_requests(ring);
+  for (int id = 0; id < pool->capacity; id++) {
+    worker_job_t *job = &pool->jobs[id];
+    if (job->worker != w || answered(ring, id))
+      continue;
+    if (++job->attempts >= WORKER_ATTEMPTS) {
+      fail_job(pool, w, id);
+    } else {
+      send_request(pool, w, id, job->host.name, job->host.len);
+    }
+  }
+
+  if (fork_worker(pool, w) == 0) {
+    pool->respawns++;
+    return;
+  }
+
+  pool->pids[w] = -1;
+  for (int id = 0; id < pool->capacity; id++) {
+    if (pool->jobs[id].worker == w && !answered(ring, id))
+      fail_job(pool, w, id);
+  }
+}
+
+static void check_workers(worker_pool_t *pool) {
+  for (int w = 0; w < pool->num_workers; w++) {
+    int status;
+    if (pool->pids[w] > 0 && waitpid(pool->pids[w], &status, WNOHANG) > 0)
+      respawn(pool, w, status);
+  }
+}
+
+/* Takes one response from any ring, starting after the last ring served
+** Each response is posted once on shm->responses; unless the caller already
+** waited for it (*token), its post is consumed here to keep the count in
+** step with the rings
+*/
+static int take_response(worker_pool_t *pool, int *token, name_handle_t *host,
+                         char *ip, int size, int *resolved,
+                         long long *elapsed_ns) {
+  for (int i = 0; i < pool->num_workers; i++) {
+    int w = (pool->next_ring + i) % pool->num_workers;
+    worker_ring_t *ring = &pool->shm->rings[w];
+    if (ring->res_tail == __atomic_load_n(&ring->res_head, __ATOMIC_ACQUIRE))
+      continue;
+
+    worker_response_t *res = &ring->res[ring->res_tail++ % WORKER_SLOTS];
+    worker_job_t *job = &pool->jobs[res->id];
+    *host = job->host;
+    *resolved = res->resolved;
+    if (res->resolved) {
+      strncpy(ip, res->ip, size);
+      ip[size - 1] = '\0';
+    }
+    *elapsed_ns = stats_now_ns() - job->started;
+
+    job->worker = -1;
+    pool->free_ids[pool->num_free++] = res->id;
+    pool->load[w]--;
+    pool->active--;
+    pool->next_ring = (w + 1) % pool->num_workers;
+
+    // a post may still be on its way, it then wakes a later wait for nothing
+    if (!*token)
+      sem_trywait(&pool->shm->responses);
+    *token = 0;
+    return 1;
+  }
+
+  return 0;
+}
+
+int worker_pool_init(worker_pool_t *pool, int num_workers) {
+  memset(pool, 0, sizeof(*pool));
+  pool->num_workers = num_workers;
+  pool->capacity = num_workers * WORKER_SLOTS;
+
+  pool->shm_size =
+      sizeof(worker_shared_t) + num_workers * sizeof(worker_ring_t);
+  void *shm = mmap(NULL, pool->shm_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  pool->jobs = malloc(pool->capacity * sizeof(worker_job_t));
+  pool->free_ids = malloc(pool->capacity * sizeof(uint32_t));
+  if (shm == MAP_FAILED || pool->jobs == NULL || pool->free_ids == NULL) {
+    fprintf(stderr, "Error allocating memory for resolver workers\n");
+    if (shm != MAP_FAILED)
+      munmap(shm, pool->shm_size);
+    free(pool->jobs);
+    free(pool->free_ids);
+    return -1;
+  }
+  pool->shm = shm;
+
+  // ids are handed out lowest first
+  for (int id = 0; id < pool->capacity; id++) {
+    pool->jobs[id].worker = -1;
+    pool->free_ids[id] = pool->capacity - 1 - id;
+  }
+  pool->num_free = pool->capacity;
+
+  sem_init(&pool->shm->responses, WORKER_PSHARED, 0);
+  for (int w = 0; w < num_workers; w++) {
+    reset_requests(&pool->shm->rings[w]);
+    pool->pids[w] = -1;
+  }
+  for (int w = 0; w < num_workers; w++) {
+    if (fork_worker(pool, w) == -1) {
+      worker_pool_free(pool);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+void worker_pool_free(worker_pool_t *pool) {
+  for (int w = 0; w < pool->num_workers; w++) {
+    if (pool->pids[w] <= 0)
+      continue;
+    // lookups still queued are abandoned, a busy worker is not waited on
+    if (pool->load[w] > 0) {
+      kill(pool->pids[w], SIGKILL);
+    } else {
+      send_request(pool, w, WORKER_QUIT, "", 0);
+    }
+  }
+  for (int w = 0; w < pool->num_workers; w++) {
+    if (pool->pids[w] > 0)
+      waitpid(pool->pids[w], NULL, 0);
+    sem_destroy(&pool->shm->rings[w].requests);
+  }
+
+  sem_destroy(&pool->shm->responses);
+  munmap(pool->shm, pool->shm_size);
+  free(pool->jobs);
+  free(pool->free_ids);
+}
+
+int worker_pool_submit(worker_pool_t *pool, const name_handle_t *host) {
+  if (pool->num_free == 0 || host->len >= MAX_NAME_LENGTH)
+    return -1;
+
+  int best = -1;
+  for (int w = 0; w < pool->num_workers; w++) {
+    if (pool->pids[w] > 0 && pool->load[w] < WORKER_SLOTS &&
+        (best == -1 || pool->load[w] < pool->load[best]))
+      best = w;
+  }
+  if (best == -1)
+    return -1; // every worker is gone
+
+  uint32_t id = pool->free_ids[--pool->num_free];
+  worker_job_t *job = &pool->jobs[id];
+  job->host = *host;
+  job->worker = best;
+  job->attempts = 0;
+  job->started = stats_now_ns();
+  pool->load[best]++;
+  pool->active++;
+
+  send_request(pool, best, id, host->name, host->len);
+  return 0;
+}
+
+int worker_pool_next(worker_pool_t *pool, long long timeout_ns,
+                     name_handle_t *host, char *ip, int size, int *resolved,
+                     long long *elapsed_ns) {
+  if (pool->active == 0)
+    return 0;
+
+  long long deadline = stats_now_ns() + timeout_ns;
+  int token = 0; // a post has been waited for and not yet matched
+  for (;;) {
+    if (take_response(pool, &token, host, ip, size, resolved, elapsed_ns))
+      return 1;
+    check_workers(pool);
+    if (take_response(pool, &token, host, ip, size, resolved, elapsed_ns))
+      return 1;
+
+    long long wait_ns = WORKER_CHECK_NS;
+    if (timeout_ns >= 0) {
+      long long left = deadline - stats_now_ns();
+      if (left <= 0)
+        return 0;
+      if (left < wait_ns)
+        wait_ns = left;
+    }
+
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    until.tv_sec += wait_ns / 1000000000LL;
+    until.tv_nsec += wait_ns % 1000000000LL;
+    if (until.tv_nsec >= 1000000000L) {
+      until.tv_sec++;
+      until.tv_nsec -= 1000000000L;
+    }
+    int woken;
+    while ((woken = sem_timedwait(&pool->shm->responses, &until)) == -1 &&
+           errno == EINTR)
+      ;
+    token = woken == 0;
+  }
+}
@@ -0,0 +1,94 @@
+#ifndef WORKERS_H
+#define WORKERS_H
+
+#include "array.h"
+#include <netinet/in.h> // for INET6_ADDRSTRLEN
+#include <semaphore.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#define MAX_WORKERS 64      // worker processes per resolver thread
+#define WORKER_SLOTS 64     // lookups queued to one worker at once
+#define WORKER_ATTEMPTS 3   // crashes a lookup may see before it is failed
+#define WORKER_CHECK_NS 10000000LL // longest wait before checking for crashes
+#define WORKER_QUIT UINT32_MAX     // request id that stops a worker
+#define WORKER_PSHARED 1 // semaphores are shared between processes
+
+typedef struct {
+  uint32_t id; // job id in the owning pool
+  char name[MAX_NAME_LENGTH];
+} worker_request_t;
+
+typedef struct {
+  uint32_t id;
+  int resolved;
+  char ip[INET6_ADDRSTRLEN]; // as dnslookup formats it
+} worker_response_t;
+
+/* Rings one worker process shares with its resolver thread
+** Both are single producer, single consumer. A worker never has more than
+** WORKER_SLOTS lookups given to it, so neither ring can overflow and only
+** the reading side of each ring has to wait
+*/
+typedef struct {
+  sem_t requests;       // one post per queued request, the worker waits
+  unsigned req_head;    // written by the resolver thread
+  unsigned req_tail;    // written by the worker
+  unsigned res_head;    // written by the worker (release)
+  unsigned res_tail;    // written by the resolver thread
+  worker_request_t req[WORKER_SLOTS];
+  worker_response_t res[WORKER_SLOTS];
+} worker_ring_t;
+
+// shared mapping, created before the workers are forked
+typedef struct {
+  sem_t responses; // one post per response, from any worker
+  worker_ring_t rings[];
+} worker_shared_t;
+
+// a lookup handed to a worker, indexed by its id
+typedef struct {
+  name_handle_t host;
+  int worker; // -1 while the job is free
+  int attempts;
+  long long started;
+} worker_job_t;
+
+/* Resolver worker processes driven by one resolver thread
+** getaddrinfo runs in the workers, so glibc's resolver locks and state are
+** per process instead of shared by every resolver thread. A worker that
+** dies is forked again and given back the lookups it had not answered
+*/
+typedef struct {
+  worker_shared_t *shm;
+  size_t shm_size;
+  pid_t pids[MAX_WORKERS]; // -1 once a worker could not be replaced
+  int load[MAX_WORKERS];   // lookups given to each worker, not yet taken back
+  int num_workers;
+  worker_job_t *jobs;
+  uint32_t *free_ids;
+  int num_free;
+  int capacity; // num_workers * WORKER_SLOTS
+  int active;   // jobs in flight
+  int respawns; // workers forked again after a crash
+  int next_ring; // where the response scan starts, for fairness
+} worker_pool_t;
+
+// maps the rings and forks num_workers workers
+int worker_pool_init(worker_pool_t *pool, int num_workers);
+// stops and reaps the workers; lookups still in flight are dropped
+void worker_pool_free(worker_pool_t *pool);
+
+// queues host on the least loaded worker, -1 if none can take it
+int worker_pool_submit(worker_pool_t *pool, const name_handle_t *host);
+
+/* Takes back one finished lookup, same contract as lookup_next
+** Waits up to timeout_ns (0 polls, -1 waits until one finishes), checking
+** for crashed workers at least every WORKER_CHECK_NS; a lookup in flight
+** on WORKER_ATTEMPTS crashed workers comes back unresolved
+*/
+int worker_pool_next(worker_pool_t *pool, long long timeout_ns,
+                     name_handle_t *host, char *ip, int size, int *resolved,
+                     long long *elapsed_ns);
+
+#endif
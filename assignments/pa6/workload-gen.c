@@ -0,0 +1,306 @@
+/* Synthetic input generator for multi-lookup benchmarks
+**
+** Writes <files> data files of <names> hostnames each into <dir>, with a
+** controllable duplicate ratio, name length range and fraction of names
+** that are not valid hostnames. Runs are reproducible for a given seed.
+*/
+#include "normalize.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define ERROR -1
+#define MAX_HOST 253  // longest valid DNS name
+#define MAX_POOL 4096 // real names read with -p
+
+const char *usage =
+    "usage: workload-gen [options] <dir>\n"
+    "  -f <files>    number of data files to write (default 10)\n"
+    "  -n <names>    hostnames per file (default 1000)\n"
+    "  -u <ratio>    fraction of names repeating an earlier name (0.0)\n"
+    "  -l <min:max>  hostname length range (default 8:30)\n"
+    "  -i <ratio>    fraction of invalid hostnames (0.0)\n"
+    "  -d <domain>   suffix for synthesized names (example.com)\n"
+    "  -p <file>     draw valid names from this list instead\n"
+    "  -s <seed>     random seed (default 1)\n";
+
+typedef struct {
+  long files;
+  long names;
+  double dup_ratio;
+  int min_len;
+  int max_len;
+  double invalid_ratio;
+  const char *domain;
+  const char *pool_path;
+  long seed;
+  const char *dir;
+} gen_options_t;
+
+// names already emitted, duplicates are drawn from here
+typedef struct {
+  char **names;
+  long count;
+  long capacity;
+} history_t;
+
+static const char label_chars[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+static const char bad_chars[] = "_!*$ ~";
+
+static int history_add(history_t *h, const char *name) {
+  if (h->count == h->capacity) {
+    long capacity = h->capacity ? h->capacity * 2 : 1024;
+    char **names = realloc(h->names, capacity * sizeof(char *));
+    if (names == NULL)
+      return ERROR;
+    h->names = names;
+    h->capacity = capacity;
+  }
+
+  h->names[h->count] = strdup(name);
+  if (h->names[h->count] == NULL)
+    return ERROR;
+  h->count++;
+
+  return 0;
+}
+
+static long rand_range(long lo, long hi) {
+  return lo + (hi > lo ? lrand48() % (hi - lo + 1) : 0);
+}
+
+/* Builds a valid name of roughly len characters ending in domain
+** Labels are 1 - 20 characters so names look like real multi-level hosts
+*/
+static void make_valid(char *out, int len, const char *domain) {
+  int dlen = strlen(domain);
+  int body = len - dlen - 1;
+  int pos = 0;
+
+  if (body < 1)
+    body = 1;
+  while (pos < body) {
+    if (pos > 0) {
+      if (body - pos < 2) {
+        // no room for another label, extend the current one
+        out[pos++] = label_chars[lrand48() % (sizeof(label_chars) - 1)];
+        continue;
+      }
+      out[pos++] = '.';
+    }
+
+    int label = rand_range(1, 20);
+    if (label > body - pos)
+      label = body - pos;
+    for (int i = 0; i < label; i++) {
+      out[pos++] = label_chars[lrand48() % (sizeof(label_chars) - 1)];
+    }
+  }
+  snprintf(out + pos, MAX_HOST + 2 - pos, ".%s", domain);
+}
+
+// corrupt name once, in one of the ways requesters should reject
+static void corrupt(char *name) {
+  int len = strlen(name);
+  switch (lrand48() % 4) {
+  case 0: // character outside the hostname alphabet
+    name[lrand48() % len] = bad_chars[lrand48() % (sizeof(bad_chars) - 1)];
+    break;
+  case 1: // leading hyphen
+    name[0] = '-';
+    break;
+  case 2: // empty label: leading dot, or two dots in a row
+    if (len < 3 || lrand48() % 2 == 0) {
+      name[0] = '.';
+    } else {
+      int at = rand_range(1, len - 2);
+      name[at] = name[at + 1] = '.';
+    }
+    break;
+  default: // label longer than 63 characters, if the name is long enough
+    if (len > MAX_LABEL_LENGTH) {
+      for (int i = 0; i <= MAX_LABEL_LENGTH; i++) {
+        if (name[i] == '.')
+          name[i] = label_chars[lrand48() % (sizeof(label_chars) - 1)];
+      }
+    } else {
+      name[0] = '.';
+    }
+    break;
+  }
+}
+
+/* Corrupts a valid name until hostname_normalize rejects it, so the
+** invalid count is exactly what -n answers without a lookup
+*/
+static void make_invalid(char *name) {
+  char copy[MAX_HOST + 2];
+  char orig[MAX_HOST + 2];
+  snprintf(orig, sizeof(orig), "%s", name);
+
+  do {
+    snprintf(name, MAX_HOST + 2, "%s", orig);
+    corrupt(name);
+    snprintf(copy, sizeof(copy), "%s", name); // normalize lowercases in place
+  } while (hostname_normalize(copy, strlen(copy)) == 0);
+}
+
+static int parse_range(const char *arg, int *lo, int *hi) {
+  if (sscanf(arg, "%d:%d", lo, hi) != 2 || *lo < 1 || *hi < *lo ||
+      *hi > MAX_HOST)
+    return ERROR;
+  return 0;
+}
+
+static int load_pool(const char *path, history_t *pool) {
+  FILE *in = fopen(path, "r");
+  if (in == NULL) {
+    fprintf(stderr, "Invalid file: %s\n", path);
+    return ERROR;
+  }
+
+  char line[MAX_HOST + 2];
+  while (pool->count < MAX_POOL && fgets(line, sizeof(line), in) != NULL) {
+    line[strcspn(line, "\n")] = 0;
+    if (line[0] != '\0' && history_add(pool, line) == ERROR) {
+      fclose(in);
+      return ERROR;
+    }
+  }
+  fclose(in);
+
+  if (pool->count == 0) {
+    fprintf(stderr, "No names in %s\n", path);
+    return ERROR;
+  }
+  return 0;
+}
+
+static int parse_args(int argc, char **argv, gen_options_t *opts) {
+  opts->files = 10;
+  opts->names = 1000;
+  opts->dup_ratio = 0.0;
+  opts->min_len = 8;
+  opts->max_len = 30;
+  opts->invalid_ratio = 0.0;
+  opts->domain = "example.com";
+  opts->pool_path = NULL;
+  opts->seed = 1;
+
+  int opt;
+  while ((opt = getopt(argc, argv, "f:n:u:l:i:d:p:s:")) != -1) {
+    switch (opt) {
+    case 'f':
+      opts->files = strtol(optarg, NULL, 10);
+      break;
+    case 'n':
+      opts->names = strtol(optarg, NULL, 10);
+      break;
+    case 'u':
+      opts->dup_ratio = strtod(optarg, NULL);
+      break;
+    case 'l':
+      if (parse_range(optarg, &opts->min_len, &opts->max_len) == ERROR) {
+        fprintf(stderr, "Invalid length range: %s\n", optarg);
+        return ERROR;
+      }
+      break;
+    case 'i':
+      opts->invalid_ratio = strtod(optarg, NULL);
+      break;
+    case 'd':
+      opts->domain = optarg;
+      break;
+    case 'p':
+      opts->pool_path = optarg;
+      break;
+    case 's':
+      opts->seed = strtol(optarg, NULL, 10);
+      break;
+    default:
+      fprintf(stderr, "%s", usage);
+      return ERROR;
+    }
+  }
+
+  if (optind != argc - 1 || opts->files < 1 || opts->names < 0 ||
+      opts->dup_ratio < 0 || opts->dup_ratio > 1 || opts->invalid_ratio < 0 ||
+      opts->invalid_ratio > 1) {
+    fprintf(stderr, "%s", usage);
+    return ERROR;
+  }
+  opts->dir = argv[optind];
+
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  gen_options_t opts;
+  if (parse_args(argc, argv, &opts) == ERROR)
+    return EXIT_FAILURE;
+
+  if (mkdir(opts.dir, 0755) == -1 && errno != EEXIST) {
+    fprintf(stderr, "Unable to create %s\n", opts.dir);
+    return EXIT_FAILURE;
+  }
+
+  history_t history = {NULL, 0, 0};
+  history_t pool = {NULL, 0, 0};
+  if (opts.pool_path != NULL && load_pool(opts.pool_path, &pool) == ERROR)
+    return EXIT_FAILURE;
+
+  srand48(opts.seed);
+
+  char path[4096];
+  char name[MAX_HOST + 2];
+  long emitted = 0, duplicates = 0, invalid = 0;
+  for (long f = 0; f < opts.files; f++) {
+    snprintf(path, sizeof(path), "%s/names%ld.txt", opts.dir, f + 1);
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+      fprintf(stderr, "Invalid file: %s\n", path);
+      return EXIT_FAILURE;
+    }
+
+    for (long n = 0; n < opts.names; n++) {
+      if (history.count > 0 && drand48() < opts.dup_ratio) {
+        fprintf(out, "%s\n", history.names[lrand48() % history.count]);
+        duplicates++;
+      } else {
+        if (pool.count > 0) {
+          snprintf(name, sizeof(name), "%s",
+                   pool.names[lrand48() % pool.count]);
+        } else {
+          make_valid(name, rand_range(opts.min_len, opts.max_len),
+                     opts.domain);
+        }
+        if (drand48() < opts.invalid_ratio) {
+          make_invalid(name);
+          invalid++;
+        }
+        if (history_add(&history, name) == ERROR) {
+          fprintf(stderr, "Failed to allocate memory\n");
+          return EXIT_FAILURE;
+        }
+        fprintf(out, "%s\n", name);
+      }
+      emitted++;
+    }
+    fclose(out);
+  }
+
+  fprintf(stdout, "wrote %ld files, %ld names (%ld duplicates, %ld invalid)\n",
+          opts.files, emitted, duplicates, invalid);
+
+  for (long i = 0; i < history.count; i++)
+    free(history.names[i]);
+  free(history.names);
+  for (long i = 0; i < pool.count; i++)
+    free(pool.names[i]);
+  free(pool.names);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,244 @@
+/*
+ * File: belady.c
+ *
+ * Replays a trace (see trace.h) under Belady's MIN policy: when frames
+ * run short, page out the resident page whose next use is furthest
+ * away, reading the future from the trace.
+ *
+ * This is a baseline, not a proven optimum. MIN is optimal for a single
+ * reference string with free, instant page transfers; here PAGEWAIT
+ * latency, pageins only of a process's current page and several
+ * processes sharing PHYSICALPAGES frames all break its assumptions, and
+ * distances are counted in instructions of the owning process, not in
+ * ticks. It should still be hard to beat by a pager that cannot see the
+ * future.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "simulator.h"
+#include "trace.h"
+#include "workload.h"
+
+#define NEVER LONG_MAX
+
+/* instructions [start,end] of a process all on one page */
+typedef struct use {
+    long start, end;
+} Use;
+
+/* every use of one page by one process, in order */
+typedef struct uses {
+    Use *use;
+    long n;
+    long next;                  /* first that may not be over yet */
+} Uses;
+
+typedef struct oracle {
+    Uses *pages;                /* [pid*procpages+page] */
+    long nprocs, procpages;
+} Oracle;
+
+static int add_use(Uses *u, long start, long end) {
+    if ((u->n & (u->n - 1)) == 0) {  /* grow at powers of two */
+	Use *grown = realloc(u->use, (u->n ? 2 * u->n : 1) * sizeof(Use));
+	if (!grown) return -1;
+	u->use = grown;
+    }
+    u->use[u->n].start = start;
+    u->use[u->n].end = end;
+    u->n++;
+    return 0;
+}
+
+static void oracle_free(Oracle *o) {
+    long i;
+    if (!o) return;
+    if (o->pages)
+	for (i = 0; i < o->nprocs * o->procpages; i++) free(o->pages[i].use);
+    free(o->pages);
+    free(o);
+}
+
+/* split the pcs of every process of machine m into its uses of each page */
+static Oracle *oracle_build(Trace *t, const Machine *m) {
+    Oracle *o = calloc(1, sizeof(Oracle));
+    long pid;
+    if (!o) return NULL;
+    o->nprocs = m->queuesize;
+    o->procpages = m->procpages;
+    o->pages = calloc(o->nprocs * o->procpages, sizeof(Uses));
+    if (!o->pages) goto fail;
+    for (pid = 0; pid < o->nprocs; pid++) {
+	Uses *u = o->pages + pid * o->procpages;
+	long k = 0, start = 0, pc = 0, page = 0;
+	while (trace_next(t, pid, &pc)) {
+	    k++;
+	    if (pc / m->pagesize != page) {
+		if (add_use(u + page, start, k - 1)) goto fail;
+		page = pc / m->pagesize;
+		start = k;
+	    }
+	}
+	if (add_use(u + page, start, k)) goto fail;
+    }
+    trace_rewind(t);
+    return o;
+
+fail:
+    oracle_free(o);
+    return NULL;
+}
+
+/* instructions until process pid, about to execute instruction k, next
+   uses page; 0 if in use now, NEVER if never again */
+static long next_use(Oracle *oracle, long pid, long page, long k) {
+    Uses *u = oracle->pages + pid * oracle->procpages + page;
+    while (u->next < u->n && u->use[u->next].end < k) u->next++;
+    if (u->next == u->n) return NEVER;
+    if (u->use[u->next].start <= k) return 0;
+    return u->use[u->next].start - k;
+}
+
+/* the oracle of the trace this simulation replays, its pager state */
+static void *min_init(Simulation *sim) {
+    return oracle_build(sim->replay, &sim->machine);
+}
+
+static void min_free(void *state) {
+    oracle_free(state);
+}
+
+static void min_pageit(Simulation *sim, Pentry q[], void *state) {
+    long p, demand = 0, outgoing = 0, pagesize = sim->machine.pagesize;
+
+    for (p = 0; p < sim->machine.processes; p++) {
+	uint64_t cur = PAGEBIT(q[p].pc / pagesize);
+	uint64_t moving;
+	if (!q[p].active) continue;
+	for (moving = q[p].transit; moving; moving &= moving - 1)
+	    if (sim->processes[p]->pages[__builtin_ctzll(moving)] < 0) outgoing++;
+	if ((q[p].resident | q[p].transit) & cur) continue;
+	if (!sim_pagein(sim, p, q[p].pc / pagesize)) demand++;
+    }
+
+    /* frames already on their way back cover that much of the demand */
+    while (demand-- > outgoing) {
+	long victim = -1, vpage = 0, furthest = 0;
+	for (p = 0; p < sim->machine.processes; p++) {
+	    Process *proc = sim->processes[p];
+	    uint64_t m;
+	    if (!q[p].active) continue;
+	    for (m = q[p].resident; m; m &= m - 1) {
+		long page = __builtin_ctzll(m);
+		long d = next_use(state, proc->pid, page, proc->compute);
+		if (d > furthest) {
+		    furthest = d;
+		    victim = p;
+		    vpage = page;
+		}
+	    }
+	}
+	if (victim < 0) break;  /* every resident page is in use */
+	sim_pageout(sim, victim, vpage);
+    }
+}
+
+/* decisions depend only on q and how far each process has run, neither
+   of which moves while every process waits */
+static void min_skip(Simulation *sim, long ticks, void *state) {
+    (void)sim;
+    (void)ticks;
+    (void)state;
+}
+
+static const Pager min_pager = { "belady", min_init, min_pageit, min_free, min_skip, NULL, TRUE };
+
+int main(int argc, char **argv) {
+    long i, procs = MAXPROCESSES, errors = 0;
+    int fast = FALSE, found;
+    const char *name = NULL, *why;
+    Machine machine;
+    const Program *progs = programs;
+    Program *loaded = NULL;
+    long nprogs = PROGRAMS;
+    Simulation *sim;
+    Trace *t;
+    FILE *f;
+
+    machine_init(&machine);
+    for (i = 1; i < argc; i++) {
+	if ((found = machine_option(&machine, argc, argv, &i))) {
+	    if (found < 0) errors++;
+	} else if (strcmp(argv[i], "-procs") == 0 && i + 1 < argc) {
+	    if (sscanf(argv[++i], "%ld", &procs) != 1 || procs < 1) {
+		fprintf(stderr, "%s: number of processors must be at least 1\n", argv[0]);
+		errors++;
+	    }
+	} else if (strcmp(argv[i], "-programs") == 0 && i + 1 < argc) {
+	    programs_free(loaded);
+	    loaded = NULL;
+	    if (programs_load(argv[++i], &loaded, &nprogs)) errors++;
+	    else progs = loaded;
+	} else if (strcmp(argv[i], "-fast") == 0) {
+	    fast = TRUE;
+	} else if (!name && argv[i][0] != '-') {
+	    name = argv[i];
+	} else {
+	    fprintf(stderr, "%s: unrecognized argument %s\n", argv[0], argv[i]);
+	    errors++;
+	}
+    }
+    if (errors || !name) {
+	fprintf(stderr, "%s usage: %s [-procs 4] [-fast] [-programs f] trace\n",
+	    argv[0], argv[0]);
+	fprintf(stderr, "  replays a trace written with -record under Belady's MIN policy\n");
+	fprintf(stderr, "  -programs f: the program file the trace was recorded with\n");
+	fprintf(stderr, "machine, default as given:\n");
+	machine_usage(stderr);
+	return EXIT_FAILURE;
+    }
+    if ((why = machine_check(&machine, progs, nprogs))) {
+	fprintf(stderr, "%s: %s\n", argv[0], why);
+	return EXIT_FAILURE;
+    }
+
+    f = fopen(name, "rb");
+    if (!f) {
+	fprintf(stderr, "%s: could not open %s\n", argv[0], name);
+	return EXIT_FAILURE;
+    }
+    t = trace_open(f, name);
+    fclose(f);
+    if (!t) return EXIT_FAILURE;
+    for (i = 0; i < machine.queuesize; i++) {
+	if (!trace_has(t, i, i % nprogs)) {
+	    fprintf(stderr, "%s: trace has no run of process %ld\n", argv[0], i);
+	    return EXIT_FAILURE;
+	}
+    }
+
+    sim = malloc(sizeof(Simulation));
+    if (!sim) {
+	fprintf(stderr, "%s: out of memory\n", argv[0]);
+	return EXIT_FAILURE;
+    }
+    sim_init(sim, &min_pager, trace_seed(t), procs);
+    sim->machine = machine;
+    sim->programs = progs;
+    sim->nprograms = nprogs;
+    sim->replay = t;
+    sim->fast_forward = fast;
+    sim->log_port = 0;
+    if (sim_run(sim)) return EXIT_FAILURE;
+    printf("belady: seed %ld, %ld processors, ratio blocked/compute=%g\n",
+	sim->seed, procs, sim_ratio(sim));
+
+    free(sim);
+    trace_free(t);
+    programs_free(loaded);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,108 @@
+/*
+ * File: evlog.c
+ *
+ * Writing binary event logs and turning them into CSV, see evlog.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulator.h"
+#include "evlog.h"
+
+static const char *what[EL_TYPES] = {
+    "load", "unload", "blocked", "unblocked", "exit",
+    "branch_from", "branch_to", "out_of_range", "restart",
+    "going", "coming", "in", "out", "out"
+};
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    p[0] = v & 0xff;
+    p[1] = (v >> 8) & 0xff;
+    p[2] = (v >> 16) & 0xff;
+    p[3] = (v >> 24) & 0xff;
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    return p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+Evlog *evlog_create(FILE *f) {
+    Evlog *l = calloc(1, sizeof(Evlog));
+    unsigned char header[12];
+    if (!l) return NULL;
+    l->buf = malloc(EVLOG_RECORDS * sizeof(Evrec));
+    if (!l->buf) {
+	free(l);
+	return NULL;
+    }
+    l->f = f;
+    memcpy(header, EVLOG_MAGIC, 4);
+    put_u32(header + 4, EVLOG_VERSION);
+    put_u32(header + 8, sizeof(Evrec));
+    if (fwrite(header, 1, sizeof(header), f) != sizeof(header)) l->failed = TRUE;
+    return l;
+}
+
+void evlog_flush(Evlog *l) {
+    if (l->n && fwrite(l->buf, sizeof(Evrec), l->n, l->f) != (size_t)l->n)
+	l->failed = TRUE;
+    l->n = 0;
+}
+
+int evlog_close(Evlog *l) {
+    int result;
+    evlog_flush(l);
+    if (fflush(l->f)) l->failed = TRUE;
+    result = l->failed ? -1 : 0;
+    free(l->buf);
+    free(l);
+    return result;
+}
+
+int evlog_csv(FILE *f, const char *name, FILE *output, FILE *pages) {
+    unsigned char header[12];
+    Evrec *buf;
+    size_t got, i;
+    long j;
+
+    if (fread(header, 1, sizeof(header), f) != sizeof(header)
+     || memcmp(header, EVLOG_MAGIC, 4) != 0
+     || get_u32(header + 4) != EVLOG_VERSION
+     || get_u32(header + 8) != sizeof(Evrec)) {
+	fprintf(stderr, "%s is not an event log written on this machine\n", name);
+	return -1;
+    }
+    buf = malloc(EVLOG_RECORDS * sizeof(Evrec));
+    if (!buf) {
+	fprintf(stderr, "out of memory reading %s\n", name);
+	return -1;
+    }
+    while ((got = fread(buf, sizeof(Evrec), EVLOG_RECORDS, f)) > 0) {
+	for (i = 0; i < got; i++) {
+	    Evrec *r = buf + i;
+	    if (r->type < 0 || r->type >= EL_TYPES) {
+		fprintf(stderr, "%s: bad record\n", name);
+		free(buf);
+		return -1;
+	    }
+	    if (r->type < EL_GOING)
+		fprintf(output, "%ld,%d,%ld,%d,%ld,%s\n", (long)r->time, r->proc,
+		    (long)r->pid, r->kind, (long)r->value, what[r->type]);
+	    else if (r->type < EL_ALLOUT)
+		fprintf(pages, "%ld,%d,%ld,%ld,%d,%s\n", (long)r->time, r->proc,
+		    (long)r->value, (long)r->pid, r->kind, what[r->type]);
+	    else
+		for (j = 0; j < r->value; j++)
+		    fprintf(pages, "%ld,%d,%ld,%ld,%d,%s\n", (long)r->time, r->proc,
+			j, (long)r->pid, r->kind, what[r->type]);
+	}
+    }
+    free(buf);
+    if (ferror(f)) {
+	fprintf(stderr, "could not read %s\n", name);
+	return -1;
+    }
+    return 0;
+}
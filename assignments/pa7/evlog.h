@@ -0,0 +1,79 @@
+/*
+ * File: evlog.h
+ *
+ * Binary event log: what -csv used to fprintf into output.csv and
+ * pages.csv, kept as fixed-size records.
+ *
+ * Records collect in a buffer of EVLOG_RECORDS and go to the file in one
+ * fwrite when it fills, so logging an event costs a few stores.
+ * evlog_csv turns a log back into output.csv and pages.csv, line for
+ * line what the simulator used to write.
+ *
+ * File format: "PA7E" version record-size, then records in native byte
+ * order; the reader refuses a log written with another layout.
+ */
+
+#ifndef EVLOG_H
+#define EVLOG_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#define EVLOG_MAGIC   "PA7E"
+#define EVLOG_VERSION 2
+#define EVLOG_RECORDS 4096
+
+/* what happened; the comment is the last column of the CSV line */
+typedef enum {
+    /* output.csv: time,proc,pid,kind,pc,what */
+    EL_LOAD, EL_UNLOAD, EL_BLOCKED, EL_UNBLOCKED, EL_EXIT,
+    EL_BRANCH_FROM, EL_BRANCH_TO, EL_OUT_OF_RANGE, EL_RESTART,
+    /* pages.csv: time,proc,page,pid,kind,what */
+    EL_GOING, EL_COMING, EL_IN, EL_OUT,
+    EL_ALLOUT,                  /* an "out" line for each of value pages */
+    EL_TYPES
+} EvlogType;
+
+typedef struct evrec {
+    int64_t time;
+    int32_t pid;
+    int32_t value;              /* pc, or page for pages.csv */
+    int32_t proc;
+    int16_t kind;
+    int16_t type;
+} Evrec;
+
+typedef struct evlog {
+    FILE *f;
+    int failed;
+    long n;                     /* records in buf */
+    Evrec *buf;
+} Evlog;
+
+/* start a log in f; NULL if out of memory */
+extern Evlog *evlog_create(FILE *f);
+
+/* write out the buffered records */
+extern void evlog_flush(Evlog *l);
+
+/* flush and free l (not f); -1 if anything failed to write */
+extern int evlog_close(Evlog *l);
+
+/* write the CSV lines of the log in f to output and pages; -1 (with a
+   message) if f is not a log */
+extern int evlog_csv(FILE *f, const char *name, FILE *output, FILE *pages);
+
+static inline void evlog_put(Evlog *l, EvlogType type, long time, long proc,
+			     long pid, long kind, long value) {
+    Evrec *r;
+    if (l->n == EVLOG_RECORDS) evlog_flush(l);
+    r = l->buf + l->n++;
+    r->time = time;
+    r->pid = (int32_t)pid;
+    r->value = (int32_t)value;
+    r->proc = (int32_t)proc;
+    r->kind = (int16_t)kind;
+    r->type = (int16_t)type;
+}
+
+#endif
@@ -0,0 +1,48 @@
+/*
+ * File: evlog2csv.c
+ *
+ * Turns an event log written with -events into the output.csv and
+ * pages.csv that -csv writes, for see.R.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "simulator.h"
+#include "evlog.h"
+
+int main(int argc, char **argv) {
+    const char *outname = "output.csv", *pagesname = "pages.csv";
+    FILE *f, *output, *pages;
+    int result;
+
+    if (argc != 2 && argc != 4) {
+	fprintf(stderr, "%s usage: %s log [output.csv pages.csv]\n", argv[0], argv[0]);
+	fprintf(stderr, "  converts an event log written with -events to CSV\n");
+	return EXIT_FAILURE;
+    }
+    if (argc == 4) {
+	outname = argv[2];
+	pagesname = argv[3];
+    }
+
+    f = fopen(argv[1], "rb");
+    if (!f) {
+	fprintf(stderr, "%s: could not open %s\n", argv[0], argv[1]);
+	return EXIT_FAILURE;
+    }
+    output = fopen(outname, "w");
+    pages = fopen(pagesname, "w");
+    if (!output || !pages) {
+	fprintf(stderr, "%s: could not open %s for writing\n", argv[0],
+	    output ? pagesname : outname);
+	return EXIT_FAILURE;
+    }
+    result = evlog_csv(f, argv[1], output, pages);
+    fclose(f);
+    if (fclose(output) || fclose(pages)) {
+	fprintf(stderr, "%s: could not write %s and %s\n", argv[0], outname, pagesname);
+	result = -1;
+    }
+    return result ? EXIT_FAILURE : EXIT_SUCCESS;
+}
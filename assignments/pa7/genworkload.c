@@ -0,0 +1,106 @@
+/*
+ * File: genworkload.c
+ *
+ * Writes a program file (see workload.h) of randomly generated programs
+ * in a chosen mix of styles, for -programs.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulator.h"
+#include "workload.h"
+
+/* parse "loop:3,scan" into weights per style; -1 if it is not one */
+static int parse_mix(char *arg, long weights[MIXES]) {
+    char *tok, *save;
+    long k, total = 0;
+    memset(weights, 0, MIXES * sizeof(long));
+    for (tok = strtok_r(arg, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+	char *colon = strchr(tok, ':');
+	long w = 1;
+	if (colon) {
+	    *colon = '\0';
+	    if (sscanf(colon + 1, "%ld", &w) != 1 || w < 1) return -1;
+	}
+	for (k = 0; k < MIXES; k++)
+	    if (strcmp(tok, mix_names[k]) == 0) break;
+	if (k == MIXES) return -1;
+	weights[k] += w;
+	total += w;
+    }
+    return total > 0 ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    long i, k, errors = 0, builtin = FALSE;
+    long seed = 1, n = 20, maxsize = MAXPC - 1, pagesize = PAGESIZE;
+    long weights[MIXES] = { 1, 1, 1, 1 }, total;
+    char mix[256] = "loop,scan,branchy,phase";
+    unsigned short xsubi[3];
+    Program *progs;
+
+    for (i = 1; i < argc; i++) {
+	if (strcmp(argv[i], "-builtin") == 0) {
+	    builtin = TRUE;
+	} else if (i + 1 < argc && strcmp(argv[i], "-seed") == 0) {
+	    if (sscanf(argv[++i], "%ld", &seed) != 1) errors++;
+	} else if (i + 1 < argc && strcmp(argv[i], "-n") == 0) {
+	    if (sscanf(argv[++i], "%ld", &n) != 1 || n < 1) errors++;
+	} else if (i + 1 < argc && strcmp(argv[i], "-maxsize") == 0) {
+	    if (sscanf(argv[++i], "%ld", &maxsize) != 1 || maxsize < 64) errors++;
+	} else if (i + 1 < argc && strcmp(argv[i], "-pagesize") == 0) {
+	    if (sscanf(argv[++i], "%ld", &pagesize) != 1 || pagesize < 1) errors++;
+	} else if (i + 1 < argc && strcmp(argv[i], "-mix") == 0) {
+	    char buf[sizeof(mix)];
+	    snprintf(buf, sizeof(buf), "%s", argv[++i]);
+	    snprintf(mix, sizeof(mix), "%s", argv[i]);
+	    if (parse_mix(buf, weights)) errors++;
+	} else {
+	    fprintf(stderr, "%s: unrecognized argument %s\n", argv[0], argv[i]);
+	    errors++;
+	}
+    }
+    if (errors) {
+	fprintf(stderr, "%s usage: %s > file\n", argv[0], argv[0]);
+	fprintf(stderr, "  -n 20          number of programs\n");
+	fprintf(stderr, "  -mix loop:2,scan\n");
+	fprintf(stderr, "                 styles (loop, scan, branchy, phase) and their weights\n");
+	fprintf(stderr, "  -seed 1        random seed\n");
+	fprintf(stderr, "  -maxsize %-5d largest program, at least 64; it must stay below\n",
+	    MAXPC - 1);
+	fprintf(stderr, "                 the pages of a process times the page size\n");
+	fprintf(stderr, "  -pagesize %-4d page size the programs are shaped for\n", PAGESIZE);
+	fprintf(stderr, "  -builtin       write the five built-in programs instead\n");
+	return EXIT_FAILURE;
+    }
+
+    if (builtin) return programs_write(stdout, programs, PROGRAMS) ? EXIT_FAILURE : EXIT_SUCCESS;
+
+    progs = calloc(n, sizeof(Program));
+    if (!progs) {
+	fprintf(stderr, "%s: out of memory\n", argv[0]);
+	return EXIT_FAILURE;
+    }
+    /* same sequence srand48(seed) would start */
+    xsubi[0] = 0x330E;
+    xsubi[1] = seed & 0xffff;
+    xsubi[2] = (seed >> 16) & 0xffff;
+    for (total = 0, k = 0; k < MIXES; k++) total += weights[k];
+
+    printf("# genworkload -seed %ld -n %ld -mix %s -maxsize %ld -pagesize %ld\n",
+	seed, n, mix, maxsize, pagesize);
+    for (i = 0; i < n; i++) {
+	long r = nrand48(xsubi) % total;
+	for (k = 0; r >= weights[k]; k++) r -= weights[k];
+	program_generate(progs + i, (Mix)k, maxsize, pagesize, xsubi);
+	printf("# %ld: %s\n", i, mix_names[k]);
+	if (programs_write(stdout, progs + i, 1)) {
+	    fprintf(stderr, "%s: could not write programs\n", argv[0]);
+	    return EXIT_FAILURE;
+	}
+    }
+    free(progs);
+    return EXIT_SUCCESS;
+}
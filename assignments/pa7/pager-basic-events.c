@@ -0,0 +1,74 @@
+// pager-basic written against the event interface: it keeps its own copy of
+// each slot from the events instead of reading a Pentry snapshot, and makes
+// the same decisions as basic_pageit, so the two runs must match exactly
+
+#include <stdlib.h>
+
+#include "simulator.h"
+
+// what basic_pageit reads from q, rebuilt from the events
+typedef struct {
+  int active;
+  long page;         // page the pc is on
+  uint64_t resident; // pages in memory and not on their way out
+} Slot;
+
+static void *basic_events_init(Simulation *sim) {
+  return calloc(sim->machine.processes, sizeof(Slot));
+}
+
+static void basic_events(Simulation *sim, const Event *ev, int nev,
+                         void *state) {
+  Slot *slots = state;
+
+  for (int i = 0; i < nev; i++) {
+    Slot *s = &slots[ev[i].proc];
+    switch (ev[i].type) {
+    case EV_LOAD:
+      s->active = 1;
+      s->page = ev[i].page;
+      s->resident = 0;
+      break;
+    case EV_UNLOAD:
+      s->active = 0;
+      s->resident = 0;
+      break;
+    case EV_PAGEIN:
+      s->resident |= PAGEBIT(ev[i].page);
+      break;
+    case EV_PAGEOUT:
+      break; // left resident when the pageout started
+    case EV_PC:
+      s->page = ev[i].page;
+      break;
+    }
+  }
+
+  // with nothing changed, the walk below would find what it found last tick
+  if (nev == 0)
+    return;
+
+  for (int proc = 0; proc < sim->machine.processes; proc++) {
+    Slot *s = &slots[proc];
+    if (!s->active)
+      continue; // select only active processes
+
+    if (s->resident & PAGEBIT(s->page))
+      break; // if the page is already in memory, then we're done
+    if (sim_pagein(sim, proc, s->page))
+      break; // if not in memory, then page it in
+
+    // basic_pageit looks for a victim only while the pc's page is
+    // resident, which it never is here, so it pages nothing out
+  }
+}
+
+// decisions depend only on the slots, so skipped ticks need no bookkeeping
+static void basic_events_skip(Simulation *sim, long ticks, void *state) {
+  (void)sim;
+  (void)ticks;
+  (void)state;
+}
+
+Pager pager = {"basic-events", basic_events_init, NULL, free,
+               basic_events_skip, basic_events, TRUE};
@@ -3,27 +3,37 @@
 
 #include "simulator.h"
 
-void pageit(Pentry q[MAXPROCESSES]) {
-  for (int proc = 0; proc < MAXPROCESSES; proc++) {
+static void basic_pageit(Simulation *sim, Pentry q[], void *state) {
+  (void)state; // stateless
+  for (int proc = 0; proc < sim->machine.processes; proc++) {
     if (q[proc].active != 1)
       continue; // select only active processes
 
     int pc = q[proc].pc;      // program counter for process
-    int page = pc / PAGESIZE; // current page the PC is on
+    int page = pc / sim->machine.pagesize; // current page the PC is on
 
     if (q[proc].pages[page])
       break; // if the page is already in memory, then we're done
-    if (pagein(proc, page))
+    if (sim_pagein(sim, proc, page))
       break; // if not in memory, then page it in
 
     for (int vic = 0;
-         vic++ < MAXPROCPAGES;) { // if the pagein fails, find pages to pageout
+         vic++ < sim->machine.procpages;) { // if the pagein fails, find pages to pageout
       if (q[proc].pages[page] != 1)
         continue; // only interested in pages that are in memory
       if (vic == page)
         continue; // make sure the incoming page isn't considered
-      if (pageout(proc, vic) == 1)
+      if (sim_pageout(sim, proc, vic) == 1)
         break; // page it out and we're done if successful
     }
   }
 }
+
+// decisions depend only on q, so skipped ticks need no bookkeeping
+static void basic_skip(Simulation *sim, long ticks, void *state) {
+  (void)sim;
+  (void)ticks;
+  (void)state;
+}
+
+Pager pager = {"basic", NULL, basic_pageit, NULL, basic_skip, NULL, FALSE};
@@ -6,31 +6,51 @@
 #include <stdlib.h>
 #include "simulator.h"
 
-void pageit(Pentry q[MAXPROCESSES]) { 
-
-    /* Static vars */
-    static int initialized = 0;
-    static int tick = 1; // artificial time
-    static int timestamps[MAXPROCESSES][MAXPROCPAGES];
-
-    /* Local vars */
-    int proc;
-    int page;
-
-    /* initialize timestamp array on first run */
-    if (!initialized) {
-        for (proc=0; proc < MAXPROCESSES; proc++) {
-            for (page=0; page < MAXPROCPAGES; page++) {
-                timestamps[proc][page] = 0; 
-            }
-        }
-        initialized = 1;
+/* per simulation state */
+typedef struct {
+    int tick; // artificial time
+    int (*timestamps)[PAGELIMIT]; // [process][page], sim->machine.processes rows
+} Lru;
+
+static void lru_free(void *state) {
+    Lru *lru = state;
+    free(lru->timestamps);
+    free(lru);
+}
+
+static void *lru_init(Simulation *sim) {
+    /* timestamps start at zero */
+    Lru *lru = calloc(1, sizeof(Lru));
+    if (!lru) return NULL;
+    lru->timestamps = calloc(sim->machine.processes, sizeof(*lru->timestamps));
+    if (!lru->timestamps) {
+        free(lru);
+        return NULL;
     }
+    lru->tick = 1;
+    return lru;
+}
+
+static void lru_pageit(Simulation *sim, Pentry q[], void *state) { 
+
+    Lru *lru = state;
+
+    (void)sim;
+    (void)q;
     
     /* TODO: Implement LRU Paging */
     fprintf(stderr, "pager-lru not yet implemented. Exiting...\n");
     exit(EXIT_FAILURE);
 
     /* advance time for next pageit iteration */
-    tick++;
-} 
+    lru->tick++;
+}
+
+/* ticks passed without a pageit call */
+static void lru_skip(Simulation *sim, long ticks, void *state) {
+    Lru *lru = state;
+    (void)sim;
+    lru->tick += ticks;
+}
+
+Pager pager = { "lru", lru_init, lru_pageit, lru_free, lru_skip, NULL, FALSE };
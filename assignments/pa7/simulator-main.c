@@ -0,0 +1,238 @@
+/*
+ * File: simulator-main.c
+ * 
+ * Command line driver: one simulation of the linked-in pager. 
+ */
+
+#include <stdio.h> 
+#include <string.h>
+#include <stdlib.h> 
+#include <signal.h>
+#include <time.h> 
+
+#include "simulator.h"
+#include "trace.h"
+#include "evlog.h"
+#include "workload.h"
+
+static Simulation *running = NULL; 	/* for the SIGINT dump */ 
+static FILE *csvlog = NULL, *csvoutput = NULL, *csvpages = NULL; /* -csv, likewise */ 
+
+/* turn the event log in logf into output.csv and pages.csv; -1 on failure */ 
+static int write_csv(FILE *logf, FILE *output, FILE *pages) { 
+    rewind(logf); 
+    if (evlog_csv(logf, "event log", output, pages) 
+     || fclose(output) || fclose(pages)) 
+	return -1; 
+    return 0; 
+} 
+
+static void endit() { 
+    if (running) { 
+	sim_print(running); 
+	if (running->log) evlog_flush(running->log); 
+	/* the history so far, as a finished run would have written it */ 
+	if (csvoutput && (fflush(csvlog) || write_csv(csvlog, csvoutput, csvpages))) 
+	    fprintf(stderr, "could not write output.csv and pages.csv\n"); 
+    } 
+    exit(0); 
+} 
+
+int main(int argc, char **argv) { 
+    
+    long i,errors=0,help=0; 
+    long seed=0; 
+    long procs=MAXPROCESSES; 
+    long log_port=LOG_ALWAYS; 
+    int fast=FALSE; 
+    FILE *recordf=NULL, *replayf=NULL; 
+    Trace *record=NULL, *replay=NULL; 
+    FILE *output=NULL, *pages=NULL, *logf=NULL; 
+    Evlog *log=NULL; 
+    const Pager *pager=default_pager(); 
+    Machine machine; 
+    Program *progs=NULL; 
+    long nprogs=0; 
+    Simulation sim; 
+    int found; 
+ 
+    signal(SIGINT, endit); 
+    machine_init(&machine); 
+    
+    for (i=1; i<argc; i++) { 
+	if ((found=machine_option(&machine,argc,argv,&i))) { 
+	    if (found<0) errors++; 
+	} else if (strcmp(argv[i],"-help")==0) { 
+	    help++;
+	} else if (strcmp(argv[i],"-all")==0) { 
+	    log_port |= LOG_LOAD|LOG_BLOCK|LOG_PAGE|LOG_BRANCH; 
+	} else if (strcmp(argv[i],"-load")==0) { 
+	    log_port |= LOG_LOAD; 
+	} else if (strcmp(argv[i],"-block")==0) { 
+	    log_port |= LOG_BLOCK; 
+	} else if (strcmp(argv[i],"-page")==0) { 
+	    log_port |= LOG_PAGE; 
+	} else if (strcmp(argv[i],"-branch")==0) { 
+	    log_port |= LOG_BRANCH; 
+	} else if (strcmp(argv[i],"-dead")==0) { 
+	    log_port |= LOG_DEAD; 
+	} else if (strcmp(argv[i],"-record")==0 && i+1<argc) { 
+	    recordf = fopen(argv[++i], "wb"); 
+	    if (!recordf) { 
+		fprintf(stderr, "%s: could not open %s for writing\n", argv[0], argv[i]); 
+		errors++; 
+	    } 
+	} else if (strcmp(argv[i],"-replay")==0 && i+1<argc) { 
+	    replayf = fopen(argv[++i], "rb"); 
+	    if (!replayf || !(replay = trace_open(replayf, argv[i]))) { 
+		if (!replayf) 
+		    fprintf(stderr, "%s: could not open %s\n", argv[0], argv[i]); 
+		errors++; 
+	    } 
+	    if (replayf) fclose(replayf); 
+	} else if (strcmp(argv[i],"-events")==0 && i+1<argc) { 
+	    logf = fopen(argv[++i], "w+b");  
+	    if (!logf) { 
+		fprintf(stderr, "%s: could not open %s for writing\n", argv[0], argv[i]); 
+		errors++; 
+	    } 
+	} else if (strcmp(argv[i],"-programs")==0 && i+1<argc) { 
+	    programs_free(progs); 
+	    progs=NULL; 
+	    if (programs_load(argv[++i], &progs, &nprogs)) errors++; 
+	} else if (strcmp(argv[i],"-fast")==0) { 
+	    fast=TRUE; 
+	} else if (strcmp(argv[i],"-seed")==0) { 
+	    if (sscanf(argv[++i],"%ld",&seed)!=1) {
+		fprintf(stderr,
+			"%s: could not read random seed from command line\n",
+			argv[0]); 
+		errors++; 
+	    } else if (seed<1 || seed>((1<<30)-1)) {
+		fprintf(stderr,
+			"%s: random seed must be between 1 and %d\n",
+			argv[0], (1<<30)-1); 
+		errors++; 
+	    } 
+	} else if (strcmp(argv[i],"-csv")==0) { 
+	    output = fopen("output.csv", "w"); 
+            if (!output) { 
+		fprintf(stderr,
+			"%s: could not open output.csv for writing\n",
+			argv[0]); 
+		errors++; 
+	    } 
+	    pages = fopen("pages.csv", "w"); 
+            if (!pages) { 
+		fprintf(stderr,
+			"%s: could not open pages.csv for writing\n",
+			argv[0]); 
+		errors++; 
+	    } 
+	} else if (strcmp(argv[i],"-procs")==0) { 
+	    if (sscanf(argv[++i],"%ld",&procs)!=1) {
+		fprintf(stderr,
+			"%s: could not read number of processors from command line\n",
+			argv[0]); 
+		errors++; 
+	    } else if (procs<1) {
+		fprintf(stderr,
+			"%s: number of processors must be at least 1\n",
+			argv[0]); 
+		errors++; 
+	    } 
+        } else { 
+	    fprintf(stderr, "t4: unrecognized argument %s\n", argv[i]); 
+	    errors++; 
+ 	} 
+    } 
+    if (errors || help) { 
+	fprintf(stderr, "%s usage: %s \n", argv[0], argv[0]); 
+        fprintf(stderr, "  -all       log everything\n"); 
+	fprintf(stderr, "  -load      log loading of processes\n"); 
+	fprintf(stderr, "  -unload    log unloading of processes\n"); 
+	fprintf(stderr, "  -branch    log program branches\n"); 
+	fprintf(stderr, "  -page      log page in and out\n"); 
+	fprintf(stderr, "  -seed 512  set random seed to 512\n"); 
+	fprintf(stderr, "  -procs 4   run only four processors (more than %d add slots)\n", 
+		MAXPROCESSES); 
+	fprintf(stderr, "  -dead      detect deadlocks\n"); 
+	fprintf(stderr, "  -fast      skip ticks in which every process waits on a page,\n"); 
+	fprintf(stderr, "             and the pager view of slots that did not change\n"); 
+	fprintf(stderr, "  -record f  write the pcs every process executes to trace f\n"); 
+	fprintf(stderr, "  -replay f  take the pcs from trace f instead of the branch engine\n"); 
+	fprintf(stderr, "             (its seed is used; branches are not logged)\n"); 
+	fprintf(stderr, "  -csv       generate output.csv and pages.csv for graphing\n");
+	fprintf(stderr, "  -events f  write the same history to binary event log f\n"); 
+	fprintf(stderr, "             (evlog2csv f turns it into the CSV files)\n"); 
+	fprintf(stderr, "  -programs f  run the programs in file f (see genworkload)\n"); 
+	fprintf(stderr, "machine, default as given:\n"); 
+	machine_usage(stderr); 
+	if(errors) {
+	    return EXIT_FAILURE;
+	}
+	else {
+	    return EXIT_SUCCESS;
+	}
+    } 
+    if (replay) seed = trace_seed(replay); 
+    if (seed==0) { 
+	seed = (time(NULL)*38491+71831+time(NULL)*time(NULL))&((1<<30)-1); 
+    } 
+    if (!pager) { 
+	fprintf(stderr, "%s: no pager linked in\n", argv[0]); 
+	return EXIT_FAILURE; 
+    } 
+    sim_init(&sim, pager, seed, procs); 
+    sim.machine = machine; 
+    if (progs) { 
+	sim.programs = progs; 
+	sim.nprograms = nprogs; 
+    } 
+    sim.log_port = log_port; 
+    sim.fast_forward = fast; 
+    if (recordf) record = trace_create(recordf, seed); 
+    sim.record = record; 
+    sim.replay = replay; 
+    /* -csv logs to a scratch file and converts it once the run is over */ 
+    if (output && !logf && !(logf = tmpfile())) { 
+	fprintf(stderr, "%s: could not create a scratch file\n", argv[0]); 
+	return EXIT_FAILURE; 
+    } 
+    if (logf && !(log = evlog_create(logf))) { 
+	fprintf(stderr, "%s: out of memory\n", argv[0]); 
+	return EXIT_FAILURE; 
+    } 
+    sim.log = log; 
+
+    csvlog = logf; 
+    csvoutput = output; 
+    csvpages = pages; 
+    running = &sim; 
+    if (sim_run(&sim)) return EXIT_FAILURE; 
+    running = NULL; 
+
+    if (record && (trace_close(record) || fclose(recordf))) { 
+	fprintf(stderr, "%s: could not write trace\n", argv[0]); 
+	return EXIT_FAILURE; 
+    } 
+    trace_free(replay); 
+    programs_free(progs); 
+    if (log && evlog_close(log)) { 
+	fprintf(stderr, "%s: could not write event log\n", argv[0]); 
+	return EXIT_FAILURE; 
+    } 
+    if (output) { 
+	if (write_csv(logf, output, pages)) { 
+	    fprintf(stderr, "%s: could not write output.csv and pages.csv\n", argv[0]); 
+	    return EXIT_FAILURE; 
+	} 
+    } 
+    if (logf && fclose(logf)) { 
+	fprintf(stderr, "%s: could not write event log\n", argv[0]); 
+	return EXIT_FAILURE; 
+    } 
+
+    return EXIT_SUCCESS;
+
+}
@@ -10,34 +10,14 @@
 #include <unistd.h>
 #include <stdlib.h> 
 #include <stdarg.h> 
-#include <signal.h>
-#include <time.h> 
+#include <stddef.h> 
 
 #include "simulator.h"
+#include "trace.h"
+#include "evlog.h"
 
 extern Program programs[PROGRAMS];
 
-FILE *output = NULL; 	/* PC history for statistical analysis */ 
-FILE *pages = NULL; 	/* block allocation history */ 
-
-static long sysclock=0; 
-static long seed=0; 
-static long procs=MAXPROCESSES;
-
-static int pageouts[MAXPROCESSES];          // track pageout() requests for pageit() invocation
-
-#define LOG_ALWAYS  (1<<0)
-#define LOG_LOAD    (1<<1)
-#define LOG_BLOCK   (1<<2)
-#define LOG_PAGE    (1<<3)
-#define LOG_BRANCH  (1<<4)
-#define LOG_DEAD    (1<<5)
-#define LOG_QUEUE   (1<<9)
-
-#include <stdio.h>
-#include <stdarg.h> 
-#include <sys/types.h>
-
 // shorthands for assertion handling
 #define CHECK(bool)   check((bool),#bool,__FILE__,__LINE__)
 #define ASSERT(bool)  assert((bool),#bool,__FILE__,__LINE__)
@@ -86,28 +66,31 @@ inline void carp(char *condition, char *file, int line) {
 	condition,line,file); 
 }
 
-static long log_port=LOG_ALWAYS;  // logging ports for output
-static void sim_log(long type, const char *format, ...) { 
+static void sim_log(Simulation *sim, long type, const char *format, ...) { 
     va_list ap; 
-    if (log_port&type) { 
+    if (sim->log_port&type) { 
 	va_start(ap, format);
-	fprintf(stderr,"%08ld: ",sysclock); vfprintf(stderr,format,ap); 
+	fprintf(stderr,"%08ld: ",sim->sysclock); vfprintf(stderr,format,ap); 
 	va_end(ap);
     } 
 } 
 
-/* keep track of physical page usage */ 
-static long pagesavail = PHYSICALPAGES; 
-
-static Process *processes[MAXPROCESSES]; 
-
 /* make a binary decision according to a 
    probability distribution */ 
-static long binary(double prob) { 
-    if (drand48()<prob) return 1; 
+static long binary(Simulation *sim, double prob) { 
+    double r; 
+    erand48_r(sim->xsubi, &sim->rand48, &r); 
+    if (r<prob) return 1; 
     else return 0; 
 } 
 
+/* nrand48 on this simulation's own state */ 
+static long nrand(Simulation *sim) { 
+    long r; 
+    nrand48_r(sim->xsubi, &sim->rand48, &r); 
+    return r; 
+} 
+
 /* clear a branching engine */ 
 static void bcontext_clear( Bcontext *c) { 
     long i; 
@@ -120,7 +103,7 @@ static void bcontext_clear( Bcontext *c) {
 } 
 
 /* initialize a branching engine */ 
-static void bcontext_init( Bcontext *c, Branch *b) { 
+static void bcontext_init(Simulation *sim, Bcontext *c, const Branch *b) { 
     long i; 
     c->bcount=0; 
     c->btype=b->btype; 
@@ -135,11 +118,11 @@ static void bcontext_init( Bcontext *c, Branch *b) {
         long cvalue; 
 	c->boffset=0; 
         c->bsize=0; 
-        cvalue=c->bvalue=binary(b->prob); 
+        cvalue=c->bvalue=binary(sim,b->prob); 
         c->bcount=0; 
         // compute future values for if statements 
         while (c->bsize<MAXBRINGS)  {
-	    if (binary(b->prob)==cvalue) { 
+	    if (binary(sim,b->prob)==cvalue) { 
 		c->brings[c->bsize]++; 
 	    } else { 
 		c->bsize++; 
@@ -153,7 +136,7 @@ static void bcontext_init( Bcontext *c, Branch *b) {
         c->bsize=0; 
         while (c->bsize<MAXBRINGS) { 
 	    if (b->max > b->min) { 
-		c->brings[c->bsize++]=lrand48()%(b->max-b->min)+b->min; 
+		c->brings[c->bsize++]=nrand(sim)%(b->max-b->min)+b->min; 
             } else { 
 		c->brings[c->bsize++]=b->min; 
             } 
@@ -165,7 +148,7 @@ static void bcontext_init( Bcontext *c, Branch *b) {
         c->bsize=0; 
         while (c->bsize<MAXBRINGS) { 
 	    if (b->max > b->min) { 
-		c->brings[c->bsize++]=lrand48()%(b->max-b->min)+b->min; 
+		c->brings[c->bsize++]=nrand(sim)%(b->max-b->min)+b->min; 
             } else { 
 		c->brings[c->bsize++]=b->min; 
             } 
@@ -190,7 +173,7 @@ static long bcontext_decide(Bcontext *c) {
     return ret; 
 } 
 
-static void process_clear(Process *q) { 
+static void process_clear(Simulation *sim, Process *q) { 
    long i; 
    q->pc = 0; 
    q->compute=q->block=0; 
@@ -203,15 +186,16 @@ static void process_clear(Process *q) {
    } 
    q->npages = 0; 
    /* no physical pages assigned */ 
-   for (i=0; i<MAXPROCPAGES; i++) {
-	q->pages[i]=-PAGEWAIT-1; 
-	q->blocked[i]=FALSE; // ALC: so simulator will log first access 
+   for (i=0; i<sim->machine.procpages; i++) {
+	q->pages[i]=-sim->machine.pagewait-1; 
    } 
+   q->blocked=0; // ALC: so simulator will log first access 
+   q->resident=q->transit=0; 
    q->active=FALSE; 
 } 
 
 /* load a program into a process */ 
-static void process_load(Process *q, Program *p, int pid, int kind) { 
+static void process_load(Simulation *sim, Process *q, const Program *p, int pid, int kind) { 
    long i; 
    q->pc = 0; 
    q->compute=q->block=0; 
@@ -220,206 +204,258 @@ static void process_load(Process *q, Program *p, int pid, int kind) {
    q->kind = kind; 
    q->nbcontexts = p->nbranches; 
    ASSERT(p->nbranches>=0 && p->nbranches<MAXBRANCHES); 
-   for (i=0; i<p->nbranches; i++) {
-       bcontext_init(q->bcontexts+i, p->branches+i); 
+   if (!sim->replay) { /* a replayed process follows its trace instead */ 
+       for (i=0; i<p->nbranches; i++) {
+	   bcontext_init(sim,q->bcontexts+i, p->branches+i); 
+       } 
    } 
    // fprintf(stderr,"actual page size for process is %d\n", (q->program->size+PAGESIZE-1)/PAGESIZE); 
-   q->npages = MAXPROCPAGES; 
-   for (i=0; i<MAXPROCPAGES; i++) { 
-	q->pages[i]=-PAGEWAIT-1; 
- 	q->blocked[i]=FALSE; // ALC: so simulator will log first access 
+   q->npages = sim->machine.procpages; 
+   for (i=0; i<q->npages; i++) { 
+	q->pages[i]=-sim->machine.pagewait-1; 
    } 
+   q->blocked=0; // ALC: so simulator will log first access 
+   q->resident=q->transit=0; 
    /* no physical pages assigned */ 
    q->active=TRUE; 			 /* now running */ 
 } 
 
+/* note a change for an event-driven pager */ 
+static void sim_event(Simulation *sim, EventType type, long proc, long page) { 
+    Event *e; 
+    if (!sim->pager->events) return; 
+    ASSERT(sim->nevents<MAXEVENTS(&sim->machine)); 
+    e=sim->events+sim->nevents++; 
+    e->type=type; 
+    e->proc=proc; 
+    e->page=page; 
+} 
+
 /* unload a process and release all resources */ 
-static void process_unload(int pnum, Process *q) { 
+static void process_unload(Simulation *sim, int pnum, Process *q) { 
    long i; 
    for (i=0; i<q->npages; i++) 
-       if (q->pages[i]>=-PAGEWAIT) { 
-	   pagesavail++; q->pages[i]=-PAGEWAIT-1; q->blocked[i]=1;
+       if (q->pages[i]>=-sim->machine.pagewait) { 
+	   sim->pagesavail++; q->pages[i]=-sim->machine.pagewait-1; q->blocked|=PAGEBIT(i);
        } 
+   q->resident=q->transit=0; 
    q->active=FALSE; 
-   sim_log(LOG_LOAD,"process %2d; pc %04d: unloaded\n",pnum, q->pc); 
+   sim_log(sim,LOG_LOAD,"process %2d; pc %04d: unloaded\n",pnum, q->pc); 
 } 
 
 /* do a branch if necessary */
-static void process_dobranch(int pnum, Process *q, Branch *b, Bcontext *c) {
+static void process_dobranch(Simulation *sim, int pnum, Process *q, const Branch *b, Bcontext *c) {
    if (bcontext_decide(c)) { 
 	// must document where we branched from
-       if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,branch_from\n", 
-		sysclock, pnum, q->pid, q->kind, q->pc); 
+       if (sim->log) evlog_put(sim->log, EL_BRANCH_FROM, sim->sysclock, pnum, 
+		q->pid, q->kind, q->pc); 
        q->pc = b->whereto; 
 	// and where we branched to
-       if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,branch_to\n", 
-		sysclock, pnum, q->pid, q->kind, q->pc); 
-       sim_log(LOG_BRANCH,"process %2d; pc %04d: branch\n",pnum, q->pc); 
+       if (sim->log) evlog_put(sim->log, EL_BRANCH_TO, sim->sysclock, pnum, 
+		q->pid, q->kind, q->pc); 
+       sim_log(sim,LOG_BRANCH,"process %2d; pc %04d: branch\n",pnum, q->pc); 
    } else { 
        q->pc++; 
-       sim_log(LOG_BRANCH,"process %2d; pc %04d: no branch\n",pnum, q->pc); 
+       sim_log(sim,LOG_BRANCH,"process %2d; pc %04d: no branch\n",pnum, q->pc); 
    } 
    if (q->pc<0 || q->pc>=q->program->size) q->pc=0; /* start over */ 
 } 
 
 /* compute one step of a process */ 
-static long process_step(int pnum, Process *q) { 
+static long process_step(Simulation *sim, int pnum, Process *q) { 
    long pc; 
    long page; 
    long max, min; 
-   Branch *b; 
+   const Branch *b; 
    Bcontext *c; 
 
    if (!q) return FALSE;  
    pc = q->pc; 
-   page = q->pc / PAGESIZE; 
+   page = q->pc / sim->machine.pagesize; 
    if (!q->active) { return FALSE; } 
 
    /* if page swapped out, don't allow to run */ 
    if (q->pages[page]!=0) { 
-	if (!q->blocked[page]) { 
-	    sim_log(LOG_BLOCK,"process=%2d page=%3d blocked\n",pnum,page);
-	    if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,blocked\n", 
-		sysclock, pnum, q->pid, q->kind, q->pc); 
-	    q->blocked[page]=TRUE; 
+	if (!(q->blocked&PAGEBIT(page))) { 
+	    sim_log(sim,LOG_BLOCK,"process=%2d page=%3d blocked\n",pnum,page);
+	    if (sim->log) evlog_put(sim->log, EL_BLOCKED, sim->sysclock, pnum, 
+		q->pid, q->kind, q->pc); 
+	    q->blocked|=PAGEBIT(page); 
 	}
 	q->block++; return TRUE; 
    } else { 
-	if (q->blocked[page]) { 
-	    sim_log(LOG_BLOCK,"process=%2d page=%3d unblocked\n",pnum,page);
-	    if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,unblocked\n",
-		sysclock,pnum, q->pid, q->kind, q->pc);
-	    q->blocked[page]=FALSE; 
+	if (q->blocked&PAGEBIT(page)) { 
+	    sim_log(sim,LOG_BLOCK,"process=%2d page=%3d unblocked\n",pnum,page);
+	    if (sim->log) evlog_put(sim->log, EL_UNBLOCKED, sim->sysclock, pnum, 
+		q->pid, q->kind, q->pc);
+	    q->blocked&=~PAGEBIT(page); 
         } 
 	q->compute++; 
    }
+   if (sim->record) trace_pc(sim->record, q->pid, q->kind, pc); 
+
+   if (sim->replay) { 
+	/* the trace knows where the pc goes next; its last pc is the exit */ 
+	if (!trace_next(sim->replay, q->pid, &q->pc)) { 
+	    if (sim->log) evlog_put(sim->log, EL_EXIT, sim->sysclock, pnum, 
+		q->pid, q->kind, q->pc);
+	    return FALSE; 
+	} 
+	return TRUE; 
+   } 
 
-   /* should I exit */ 
+   /* should I exit; a program without exits never does */ 
    ASSERT(q->program->nexits>=0 && q->program->nexits<=MAXEXITS); 
    min=0; max=q->program->nexits-1; 
    while (min+1<max) { 
        long mid=(min+max)/2; 
        if (pc==q->program->exits[mid]) { 
-	    if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,exit\n", 
-		sysclock, pnum, q->pid, q->kind, q->pc);
+	    if (sim->log) evlog_put(sim->log, EL_EXIT, sim->sysclock, pnum, 
+		q->pid, q->kind, q->pc);
 	    return FALSE; 
        } 
        else if (pc<q->program->exits[mid])  max=mid; 
        else                                 min=mid; 
    } 
-   if (pc==q->program->exits[min] || pc==q->program->exits[max]) { 
-	if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,exit\n", 
-	    sysclock, pnum, q->pid, q->kind, q->pc);
+   if (max>=0 && (pc==q->program->exits[min] || pc==q->program->exits[max])) { 
+	if (sim->log) evlog_put(sim->log, EL_EXIT, sim->sysclock, pnum, 
+	    q->pid, q->kind, q->pc);
 	return FALSE; 
    } 
    b = q->program->branches; 
    c = q->bcontexts; 
    ASSERT(q->program->nbranches>=0 && q->program->nbranches<=MAXBRANCHES); 
    min=0; max=q->program->nbranches-1; 
+   if (max<0) { 
+	/* no branches: the search has always met an empty first branch, a 
+	   GOTO from pc 0 to itself taken on every other visit, and runs of 
+	   branchless programs depend on it, so it stays, without reading 
+	   past either end of the table */ 
+	static const Branch empty; 
+	b=&empty; 
+	max=0; 
+   } 
    while (min+1<max) { 
        long mid=(min+max)/2; 
        if (pc==b[mid].wherefrom) {
-	    process_dobranch(pnum,q,b+mid,c+mid);
+	    process_dobranch(sim,pnum,q,b+mid,c+mid);
 	    return TRUE;
        }
        else if (pc<b[mid].wherefrom) max=mid; 
        else                          min=mid; 
    } 
-   if (pc==b[min].wherefrom) { process_dobranch(pnum,q,b+min,c+min); return TRUE; } 
-   if (pc==b[max].wherefrom) { process_dobranch(pnum,q,b+max,c+max); return TRUE; } 
+   if (pc==b[min].wherefrom) { process_dobranch(sim,pnum,q,b+min,c+min); return TRUE; } 
+   if (pc==b[max].wherefrom) { process_dobranch(sim,pnum,q,b+max,c+max); return TRUE; } 
    q->pc++; /* default action */ 
    if (q->pc<0 || q->pc>q->program->size) { 
-	if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,out_of_range\n", 
-	    sysclock, pnum, q->pid, q->kind, q->pc);
+	if (sim->log) evlog_put(sim->log, EL_OUT_OF_RANGE, sim->sysclock, pnum, 
+	    q->pid, q->kind, q->pc);
 	q->pc=0; /* start over */ 
-	if (output) fprintf(output, "%ld,%d,%ld,%ld,%ld,restart\n", 
-	    sysclock, pnum, q->pid, q->kind, q->pc);
+	if (sim->log) evlog_put(sim->log, EL_RESTART, sim->sysclock, pnum, 
+	    q->pid, q->kind, q->pc);
    } 
    return TRUE; 
 } 
    
 
 /* public routine: swap one page out */ 
-int pageout(int process, int page) { 
-    if (process<0 || process>=procs 
-     || !processes[process]
-     || !processes[process]->active
+int sim_pageout(Simulation *sim, int process, int page) { 
+    if (process<0 || process>=sim->procs 
+     || !sim->processes[process]
+     || !sim->processes[process]->active
      || page<0
-     || page>=processes[process]->npages
-//     || pageouts[process]           // we've already had a successful pageout()
+     || page>=sim->processes[process]->npages
+//     || sim->pageouts[process]           // we've already had a successful pageout()
     ) 
 	return FALSE; 
-    if (processes[process]->pages[page]<0) 
+    if (sim->processes[process]->pages[page]<0) 
 	return TRUE; /* on its way out */ 
-    if (processes[process]->pages[page]>0) 
+    if (sim->processes[process]->pages[page]>0) 
 	return FALSE; /* not available to swap out */ 
-sim_log(LOG_PAGE,"process=%2d page=%3d start pageout\n",process,page);
-    if (pages) fprintf(pages,"%ld,%d,%d,%ld,%ld,going\n",
-	sysclock,process,page,processes[process]->pid, processes[process]->kind); 
-    pageouts[process] = 1;          // note first pageout()
-    processes[process]->pages[page]=-1; return TRUE;
+sim_log(sim,LOG_PAGE,"process=%2d page=%3d start pageout\n",process,page);
+    if (sim->log) evlog_put(sim->log, EL_GOING, sim->sysclock, process, 
+	sim->processes[process]->pid, sim->processes[process]->kind, page); 
+    sim->changes++; 
+    sim->pageouts[process] = 1;          // note first pageout()
+    sim->processes[process]->resident&=~PAGEBIT(page); 
+    sim->processes[process]->transit|=PAGEBIT(page); 
+    sim->processes[process]->pages[page]=-1; return TRUE;
 } 
 
 /* public routine: swap one page in */ 
-int pagein(int process, int page) { 
-    if (process<0 || process>=procs 
-     || !processes[process]
-     || !processes[process]->active
-     || processes[process]->pc/PAGESIZE != page         // don't allow predictive pageins
-     || page<0 || page>=processes[process]->npages)
+int sim_pagein(Simulation *sim, int process, int page) { 
+    if (process<0 || process>=sim->procs 
+     || !sim->processes[process]
+     || !sim->processes[process]->active
+     || sim->processes[process]->pc/sim->machine.pagesize != page   // don't allow predictive pageins
+     || page<0 || page>=sim->processes[process]->npages)
 	return FALSE; 
-    if (processes[process]->pages[page]>=0) 
+    if (sim->processes[process]->pages[page]>=0) 
 	return TRUE; /* on its way */ 
-    if (pagesavail==0) 
+    if (sim->pagesavail==0) 
 	return FALSE; 
-    if (processes[process]->pages[page]>=-PAGEWAIT ) 
+    if (sim->processes[process]->pages[page]>=-sim->machine.pagewait ) 
 	return FALSE; /* not yet out */ 
-    sim_log(LOG_PAGE,"process=%2d page=%3d start pagein\n",process,page);
-    if (pages) fprintf(pages,"%ld,%d,%d,%ld,%ld,coming\n",
-	sysclock,process,page,processes[process]->pid, processes[process]->kind); 
-    processes[process]->pages[page]=PAGEWAIT; pagesavail--; return TRUE; 
+    sim_log(sim,LOG_PAGE,"process=%2d page=%3d start pagein\n",process,page);
+    if (sim->log) evlog_put(sim->log, EL_COMING, sim->sysclock, process, 
+	sim->processes[process]->pid, sim->processes[process]->kind, page); 
+    sim->changes++; 
+    sim->processes[process]->transit|=PAGEBIT(page); 
+    sim->processes[process]->pages[page]=sim->machine.pagewait; sim->pagesavail--; return TRUE; 
+} 
+
+/* simulation whose pager is running on this thread, for pagein/pageout */ 
+static __thread Simulation *current_sim = NULL; 
+
+int pageout(int process, int page) { 
+    if (!current_sim) return FALSE; 
+    return sim_pageout(current_sim, process, page); 
+} 
+
+int pagein(int process, int page) { 
+    if (!current_sim) return FALSE; 
+    return sim_pagein(current_sim, process, page); 
 } 
 
 /*============
    job queue
   ============*/ 
 
-static long queuetype[QUEUESIZE]; 
-static Process queue[QUEUESIZE];
-static long queueend; 
-static void initqueue() { 
+static void initqueue(Simulation *sim) { 
 /*
    long i,repeats; 
-   for (i=0; i<QUEUESIZE; i++) queuetype[i]=lrand48()%PROGRAMS; 
+   for (i=0; i<QUEUESIZE; i++) sim->queuetype[i]=nrand(sim)%PROGRAMS; 
    for (repeats=0; repeats<10; repeats++) 
        for (i=0; i<QUEUESIZE; i++) { 
-	  int j=lrand48()%QUEUESIZE;
-	  long temp=queuetype[i]; queuetype[i]=queuetype[j]; queuetype[j]=temp; 
+	  int j=nrand(sim)%QUEUESIZE;
+	  long temp=sim->queuetype[i]; sim->queuetype[i]=sim->queuetype[j]; sim->queuetype[j]=temp; 
        } 
 */
-   for (int i=0; i<QUEUESIZE; i++) { 
-        queuetype[i]=i%PROGRAMS; 
-        process_clear(queue+i); 
-    	process_load(queue+i,programs+queuetype[i], i, queuetype[i]); 
+   for (int i=0; i<sim->machine.queuesize; i++) { 
+        sim->queuetype[i]=i%sim->nprograms; 
+        process_clear(sim,sim->queue+i); 
+    	process_load(sim,sim->queue+i,sim->programs+sim->queuetype[i], i, sim->queuetype[i]); 
    } 
-   queueend=0; 
+   sim->queueend=0; 
 } 
-static Process * dequeue() { 
-   if (queueend<QUEUESIZE) return queue+queueend++; 
+static Process * dequeue(Simulation *sim) { 
+   if (sim->queueend<sim->machine.queuesize) return sim->queue+sim->queueend++; 
    else return NULL; 
 } 
-static long empty() { return queueend>=QUEUESIZE; } 
+static long empty(Simulation *sim) { return sim->queueend>=sim->machine.queuesize; } 
 
 /*===========================
-   control of all processes 
+   control of all sim->processes 
   ===========================*/ 
 
-static void allprint() { 
+static void allprint(Simulation *sim) { 
     int i,j; 
+    int half=sim->machine.processes/2, pagewait=sim->machine.pagewait; 
+    if (!sim->processes) return; 	/* not running */ 
     fprintf(stderr,"\nprocess  "); 
-    for (i=0; i<MAXPROCESSES/2; i++) { 
+    for (i=0; i<half; i++) { 
 	if (i) fprintf(stderr," | "); 
-	if (processes[i] && processes[i]->active) { 
+	if (sim->processes[i] && sim->processes[i]->active) { 
 	    fprintf(stderr,"  %02d",i); 
         } else { 
 	    fprintf(stderr,"  --"); 
@@ -427,41 +463,41 @@ static void allprint() {
     } 
     fprintf(stderr,"\n"); 
     fprintf(stderr,"pc       "); 
-    for (i=0; i<MAXPROCESSES/2; i++) { 
+    for (i=0; i<half; i++) { 
 	if (i) fprintf(stderr," | "); 
-	if (processes[i] && processes[i]->active) { 
-	    fprintf(stderr,"%04ld",processes[i]->pc); 
+	if (sim->processes[i] && sim->processes[i]->active) { 
+	    fprintf(stderr,"%04ld",sim->processes[i]->pc); 
         } else { 
 	    fprintf(stderr,"----"); 
         }
     } 
     fprintf(stderr,"\n"); 
-    for (j=0; j<MAXPROCPAGES; j++) { 
+    for (j=0; j<sim->machine.procpages; j++) { 
 	fprintf(stderr,"page%02d  ",j); 
-	for (i=0; i<MAXPROCESSES/2; i++) { 
+	for (i=0; i<half; i++) { 
 	    if (i) fprintf(stderr," |"); 
-	    if (processes[i] && processes[i]->active) { 
-		int pcblock =  processes[i]->pc/PAGESIZE; 
+	    if (sim->processes[i] && sim->processes[i]->active) { 
+		int pcblock =  sim->processes[i]->pc/sim->machine.pagesize; 
 		if (j==pcblock) { 
-		    if (processes[i]->pages[j]>0) 
-			fprintf(stderr,"*i%3ld",processes[i]->pages[j]); 
-		    else if (processes[i]->pages[j]==0) 
+		    if (sim->processes[i]->pages[j]>0) 
+			fprintf(stderr,"*i%3ld",sim->processes[i]->pages[j]); 
+		    else if (sim->processes[i]->pages[j]==0) 
 			fprintf(stderr,"*=in "); 
-		    else if (processes[i]->pages[j]==-100) 
+		    else if (sim->processes[i]->pages[j]==-pagewait) 
 			fprintf(stderr,"*=out"); 
 		    else 
-			fprintf(stderr,"*o%3ld",100+processes[i]->pages[j]); 
-		    // fprintf(stderr,"*%4d",processes[i]->pages[j]); 
+			fprintf(stderr,"*o%3ld",pagewait+sim->processes[i]->pages[j]); 
+		    // fprintf(stderr,"*%4d",sim->processes[i]->pages[j]); 
 	  	} else { 
-		    if (processes[i]->pages[j]>0) 
-			fprintf(stderr," i%3ld",processes[i]->pages[j]); 
-		    else if (processes[i]->pages[j]==0) 
+		    if (sim->processes[i]->pages[j]>0) 
+			fprintf(stderr," i%3ld",sim->processes[i]->pages[j]); 
+		    else if (sim->processes[i]->pages[j]==0) 
 			fprintf(stderr," =in "); 
-		    else if (processes[i]->pages[j]==-100) 
+		    else if (sim->processes[i]->pages[j]==-pagewait) 
 			fprintf(stderr," =out"); 
 		    else 
-			fprintf(stderr," o%3ld",100+processes[i]->pages[j]); 
-		    // fprintf(stderr," %4d",processes[i]->pages[j]); 
+			fprintf(stderr," o%3ld",pagewait+sim->processes[i]->pages[j]); 
+		    // fprintf(stderr," %4d",sim->processes[i]->pages[j]); 
 		} 
 	    } else { 
 		fprintf(stderr," ----"); 
@@ -471,9 +507,9 @@ static void allprint() {
     } 
     fprintf(stderr,"----------------------------------------------------------------------------\n"); 
     fprintf(stderr,"process  "); 
-    for (i=MAXPROCESSES/2; i<MAXPROCESSES; i++) {
-	if (i-MAXPROCESSES/2) fprintf(stderr," | "); 
-	if (processes[i] && processes[i]->active) { 
+    for (i=half; i<sim->machine.processes; i++) {
+	if (i-half) fprintf(stderr," | "); 
+	if (sim->processes[i] && sim->processes[i]->active) { 
 	    fprintf(stderr,"  %02d",i); 
         } else { 
 	    fprintf(stderr,"  --"); 
@@ -481,41 +517,41 @@ static void allprint() {
     } 
     fprintf(stderr,"\n"); 
     fprintf(stderr,"pc       "); 
-    for (i=MAXPROCESSES/2; i<MAXPROCESSES; i++) {
-	if (i-MAXPROCESSES/2) fprintf(stderr," | "); 
-	if (processes[i] && processes[i]->active) { 
-	    fprintf(stderr,"%04ld",processes[i]->pc); 
+    for (i=half; i<sim->machine.processes; i++) {
+	if (i-half) fprintf(stderr," | "); 
+	if (sim->processes[i] && sim->processes[i]->active) { 
+	    fprintf(stderr,"%04ld",sim->processes[i]->pc); 
         } else { 
 	    fprintf(stderr,"----"); 
         }
     } 
     fprintf(stderr,"\n"); 
-    for (j=0; j<MAXPROCPAGES; j++) { 
+    for (j=0; j<sim->machine.procpages; j++) { 
 	fprintf(stderr,"page%02d  ",j); 
-	for (i=MAXPROCESSES/2; i<MAXPROCESSES; i++) {
-	    if (i-MAXPROCESSES/2) fprintf(stderr," |"); 
-	    if (processes[i] && processes[i]->active) { 
-		int pcblock =  processes[i]->pc/PAGESIZE; 
+	for (i=half; i<sim->machine.processes; i++) {
+	    if (i-half) fprintf(stderr," |"); 
+	    if (sim->processes[i] && sim->processes[i]->active) { 
+		int pcblock =  sim->processes[i]->pc/sim->machine.pagesize; 
 		if (j==pcblock) { 
-		    if (processes[i]->pages[j]>0) 
-			fprintf(stderr,"*i%3ld",processes[i]->pages[j]); 
-		    else if (processes[i]->pages[j]==0) 
+		    if (sim->processes[i]->pages[j]>0) 
+			fprintf(stderr,"*i%3ld",sim->processes[i]->pages[j]); 
+		    else if (sim->processes[i]->pages[j]==0) 
 			fprintf(stderr,"*=in "); 
-		    else if (processes[i]->pages[j]==-100) 
+		    else if (sim->processes[i]->pages[j]==-pagewait) 
 			fprintf(stderr,"*=out"); 
 		    else 
-			fprintf(stderr,"*o%3ld",100+processes[i]->pages[j]); 
-		    // fprintf(stderr,"*%4d",processes[i]->pages[j]); 
+			fprintf(stderr,"*o%3ld",pagewait+sim->processes[i]->pages[j]); 
+		    // fprintf(stderr,"*%4d",sim->processes[i]->pages[j]); 
 	  	} else {
-		    if (processes[i]->pages[j]>0) 
-			fprintf(stderr," i%3ld",processes[i]->pages[j]); 
-		    else if (processes[i]->pages[j]==0) 
+		    if (sim->processes[i]->pages[j]>0) 
+			fprintf(stderr," i%3ld",sim->processes[i]->pages[j]); 
+		    else if (sim->processes[i]->pages[j]==0) 
 			fprintf(stderr," =in "); 
-		    else if (processes[i]->pages[j]==-100) 
+		    else if (sim->processes[i]->pages[j]==-pagewait) 
 			fprintf(stderr," =out"); 
 		    else 
-			fprintf(stderr," o%3ld",100+processes[i]->pages[j]); 
-		    // fprintf(stderr," %4d",processes[i]->pages[j]); 
+			fprintf(stderr," o%3ld",pagewait+sim->processes[i]->pages[j]); 
+		    // fprintf(stderr," %4d",sim->processes[i]->pages[j]); 
 		} 
 	    } else { 
 		fprintf(stderr," ----"); 
@@ -526,134 +562,139 @@ static void allprint() {
     fprintf(stderr,"----------------------------------------------------------------------------\n"); 
 } 
 
-static void endit() { allprint(); exit(0); } 
-  
-static void allinit () { 
+static void allinit(Simulation *sim) { 
     long i; 
-    initqueue(); 
-    for (i=0; i<MAXPROCESSES; i++) processes[i]=NULL; 
-    for (i=0; i<procs; i++) { 
+    initqueue(sim); 
+    for (i=0; i<sim->machine.processes; i++) sim->processes[i]=NULL; 
+    for (i=0; i<sim->procs; i++) { 
 	// zero out pages from processes
-	if (!empty()) {
-	    processes[i]=dequeue(); 
-
-	    sim_log(LOG_LOAD,"process %2d; pc %04d: loaded\n",i, processes[i]->pc); 
-	    if (output) fprintf(output, "%ld,%ld,%ld,%ld,%ld,load\n", 
-		sysclock, i, processes[i]->pid, 
-		processes[i]->kind, processes[i]->pc);
-	    if (pages) { 
-		long j;
-		for (j=0; j<MAXPROCPAGES; j++) 
-		    fprintf(pages,"%ld,%ld,%ld,%ld,%ld,out\n",
-			sysclock,i,j,processes[i]->pid,processes[i]->kind); 
+	if (!empty(sim)) {
+	    sim->processes[i]=dequeue(sim); 
+
+	    sim_log(sim,LOG_LOAD,"process %2d; pc %04d: loaded\n",i, sim->processes[i]->pc); 
+	    sim_event(sim,EV_LOAD,i,sim->processes[i]->pc/sim->machine.pagesize); 
+	    if (sim->log) { 
+		evlog_put(sim->log, EL_LOAD, sim->sysclock, i, 
+		    sim->processes[i]->pid, sim->processes[i]->kind, sim->processes[i]->pc);
+		evlog_put(sim->log, EL_ALLOUT, sim->sysclock, i, 
+		    sim->processes[i]->pid, sim->processes[i]->kind, sim->machine.procpages); 
 	    } 
 	} 
     } 
 } 
 
-static void allscore() { 
-    int i; 
-    int block=0; 
-    int compute=0; 
-    for (i=0; i<QUEUESIZE; i++) { 
-	block+=queue[i].block; 
-	compute+=queue[i].compute; 
+static void allscore(Simulation *sim) { 
+    long i; 
+    long block=0; 
+    long compute=0; 
+    for (i=0; i<sim->machine.queuesize; i++) { 
+	block+=sim->queue[i].block; 
+	compute+=sim->queue[i].compute; 
     } 
-    sim_log(LOG_ALWAYS, "simulation ends\n"); 
-    sim_log(LOG_ALWAYS, "%d blocked cycles\n",block); 
-    sim_log(LOG_ALWAYS, "%d compute cycles\n",compute); 
-    sim_log(LOG_ALWAYS, "ratio blocked/compute=%g\n",(double)block/(double)compute); 
+    sim_log(sim,LOG_ALWAYS, "simulation ends\n"); 
+    sim_log(sim,LOG_ALWAYS, "%ld blocked cycles\n",block); 
+    sim_log(sim,LOG_ALWAYS, "%ld compute cycles\n",compute); 
+    sim_log(sim,LOG_ALWAYS, "ratio blocked/compute=%g\n",(double)block/(double)compute); 
+    sim->block=block; 
+    sim->compute=compute; 
 
 } 
 
-static void allstep () { 
+static void allstep(Simulation *sim) { 
     long i; 
-    for (i=0; i<procs; i++) { 
-	if (!process_step(i,processes[i])) { 
-	    if (processes[i] && processes[i]->active) { 
+    for (i=0; i<sim->procs; i++) { 
+	long pagesize=sim->machine.pagesize; 
+	long page=sim->processes[i] ? sim->processes[i]->pc/pagesize : -1; 
+	if (process_step(sim,i,sim->processes[i])) { 
+	    if (sim->processes[i]->pc/pagesize!=page) 
+		sim_event(sim,EV_PC,i,sim->processes[i]->pc/pagesize); 
+	} else { 
+	    if (sim->processes[i] && sim->processes[i]->active) { 
 		// document final PC position 
-		if (output) fprintf(output, "%ld,%ld,%ld,%ld,%ld,unload\n", 
-		    sysclock, i, processes[i]->pid, 
-		    processes[i]->kind, processes[i]->pc);
-		if (pages) { 
-		    long j;
-		    for (j=0; j<MAXPROCPAGES; j++) 
-			fprintf(pages,"%ld,%ld,%ld,%ld,%ld,out\n",
-			    sysclock,i,j,processes[i]->pid, processes[i]->kind); 
+		if (sim->log) { 
+		    evlog_put(sim->log, EL_UNLOAD, sim->sysclock, i, 
+			sim->processes[i]->pid, sim->processes[i]->kind, sim->processes[i]->pc);
+		    evlog_put(sim->log, EL_ALLOUT, sim->sysclock, i, 
+			sim->processes[i]->pid, sim->processes[i]->kind, sim->machine.procpages); 
 		} 
-		process_unload(i,processes[i]); 
+		process_unload(sim,i,sim->processes[i]); 
+		if (sim->record) trace_exit(sim->record, sim->processes[i]->pid); 
+		sim_event(sim,EV_UNLOAD,i,0); 
 	    } 
-	    processes[i]=NULL; 
-            if (!empty()) {
-		processes[i]=dequeue();
-	        sim_log(LOG_LOAD,"process %2d; pc %04d: loaded\n",i, processes[i]->pc); 
-		if (output) fprintf(output, "%ld,%ld,%ld,%ld,%ld,load\n", 
-		    sysclock, i, processes[i]->pid, 
-		    processes[i]->kind, processes[i]->pc);
+	    sim->processes[i]=NULL; 
+            if (!empty(sim)) {
+		sim->processes[i]=dequeue(sim);
+	        sim_log(sim,LOG_LOAD,"process %2d; pc %04d: loaded\n",i, sim->processes[i]->pc); 
+		sim_event(sim,EV_LOAD,i,sim->processes[i]->pc/pagesize); 
+		if (sim->log) evlog_put(sim->log, EL_LOAD, sim->sysclock, i, 
+		    sim->processes[i]->pid, sim->processes[i]->kind, sim->processes[i]->pc);
 	    } 
 	} 
     } 
 } 
 
-static long alldone () { 
+static long alldone(Simulation *sim) { 
     long i; 
-    for (i=0; i<procs; i++) { 
-	if (processes[i] && processes[i]->active) return FALSE; 
+    for (i=0; i<sim->procs; i++) { 
+	if (sim->processes[i] && sim->processes[i]->active) return FALSE; 
     } 
     return TRUE; 
 } 
 
-static int allblocked() { 
+static int allblocked(Simulation *sim) { 
     int allfree=0; 
     int runnable=0; 
     int memwait=0; 
     int freewait=0; 
     int i,stat; 
-    for (i=0; i<procs; i++) 
-	if (processes[i] && processes[i]->active) { 
-	    stat=processes[i]->pages[(int)(processes[i]->pc/PAGESIZE)]; 
+    for (i=0; i<sim->procs; i++) 
+	if (sim->processes[i] && sim->processes[i]->active) { 
+	    stat=sim->processes[i]->pages[(int)(sim->processes[i]->pc/sim->machine.pagesize)]; 
 	    if (stat>0) memwait++;	/* waiting for swap in */ 
 	    else if (stat==0) runnable++; /* ok */ 
-	    else if (stat<-PAGEWAIT) allfree++; /* free */
+	    else if (stat<-sim->machine.pagewait) allfree++; /* free */
 	    else freewait++; /* waiting for swap out */ 
 	} 
 
     if (allfree && !memwait && !runnable && !freewait) { 
-	sim_log(LOG_DEAD,"%d process pcs waiting for swap in\n",memwait); 
-	sim_log(LOG_DEAD,"%d process pcs runnable\n",runnable); 
-	sim_log(LOG_DEAD,"%d process pcs waiting for swap out\n",freewait); 
-	sim_log(LOG_DEAD,"%d process pcs swapped out\n",allfree); 
-	sim_log(LOG_DEAD, "All needed pages swapped out!\n"); 
-	// allprint(); 
+	sim_log(sim,LOG_DEAD,"%d process pcs waiting for swap in\n",memwait); 
+	sim_log(sim,LOG_DEAD,"%d process pcs runnable\n",runnable); 
+	sim_log(sim,LOG_DEAD,"%d process pcs waiting for swap out\n",freewait); 
+	sim_log(sim,LOG_DEAD,"%d process pcs swapped out\n",allfree); 
+	sim_log(sim,LOG_DEAD, "All needed pages swapped out!\n"); 
+	// allprint(sim); 
 	return 1; 
     } else { 
 	return 0; 
     } 
 } 
 
-static void allage () { 
+static void allage(Simulation *sim) { 
    long i; 
-   for (i=0; i<procs; i++) { 
-       if (processes[i] && processes[i]->active) { 
-    	   long j; 	
-	   for (j=0; j<processes[i]->npages; j++) {
-                if (processes[i]->pages[j]==0) ; 
-                else if (processes[i]->pages[j]<-PAGEWAIT) ; 
-		else if (processes[i]->pages[j]>0) { 
-		    processes[i]->pages[j]--; 
-		    if (processes[i]->pages[j]==0) { 
-			sim_log(LOG_PAGE,"process=%2d page=%3d end   pagein\n",i,j);
-			if (pages) fprintf(pages,"%ld,%ld,%ld,%ld,%ld,in\n",
-			    sysclock,i,j,processes[i]->pid, processes[i]->kind); 
+   for (i=0; i<sim->procs; i++) { 
+       Process *q=sim->processes[i]; 
+       if (q && q->active) { 
+	   uint64_t moving=q->transit; 	/* only these pages count down */ 
+	   while (moving) { 
+		long j=__builtin_ctzll(moving); 
+		moving&=moving-1; 
+		if (q->pages[j]>0) { 
+		    q->pages[j]--; 
+		    if (q->pages[j]==0) { 
+			q->transit&=~PAGEBIT(j); 
+			q->resident|=PAGEBIT(j); 
+			sim_log(sim,LOG_PAGE,"process=%2d page=%3d end   pagein\n",i,j);
+			sim_event(sim,EV_PAGEIN,i,j); 
+			if (sim->log) evlog_put(sim->log, EL_IN, sim->sysclock, i, q->pid, q->kind, j); 
 		    } 
-		} else if (processes[i]->pages[j]<0 
-                       && processes[i]->pages[j]>=-PAGEWAIT) {
-		    processes[i]->pages[j]--; 
-		    if(processes[i]->pages[j]<-PAGEWAIT) { 
-			sim_log(LOG_PAGE,"process=%2d page=%3d end   pageout\n",i,j);
-			if (pages) fprintf(pages,"%ld,%ld,%ld,%ld,%ld,out\n",
-			    sysclock,i,j,processes[i]->pid, processes[i]->kind); 
-			pagesavail++; 
+		} else { 
+		    q->pages[j]--; 
+		    if(q->pages[j]<-sim->machine.pagewait) { 
+			q->transit&=~PAGEBIT(j); 
+			sim_log(sim,LOG_PAGE,"process=%2d page=%3d end   pageout\n",i,j);
+			sim_event(sim,EV_PAGEOUT,i,j); 
+			if (sim->log) evlog_put(sim->log, EL_OUT, sim->sysclock, i, q->pid, q->kind, j); 
+			sim->pagesavail++; 
 		    } 
                 } 
 	    } 
@@ -661,130 +702,307 @@ static void allage () {
    } 
 } 
 
-static void callyou() { 
+/* hand the events since the last call to an event-driven pager */ 
+static void callyou_events(Simulation *sim) { 
+    memset(sim->pageouts, 0, sim->machine.processes*sizeof(int)); 
+    sim->changes = 0; 
+    current_sim = sim; 
+    sim->pager->events(sim, sim->events, sim->nevents, sim->pager_state); 
+    current_sim = NULL; 
+    sim->nevents = 0; 
+} 
+
+static void callyou(Simulation *sim) { 
     long i,j; 
-    Pentry pentry[MAXPROCESSES];
-    for (i=0; i<MAXPROCESSES; i++) { 
-	if (processes[i]) { 
-	    pentry[i].active=processes[i]->active; 
-	    pentry[i].pc=processes[i]->pc; 
-	    pentry[i].npages = processes[i]->npages; 
-	    for (j=0; j<processes[i]->npages; j++) {
-		pentry[i].pages[j]=(processes[i]->pages[j]==0); 
-	    } 
-	    for (; j<MAXPROCPAGES; j++) pentry[i].pages[j]=FALSE; 
+    Pentry *pentry=sim->pentry;
+    /* a pager that set skip only reads q, so with fast_forward the 
+       compatibility view of a slot is rebuilt only when its resident 
+       mask changed; blocked slots keep theirs while they count down */ 
+    int keepview=sim->fast_forward && sim->pager->skip; 
+    if (sim->pager->events) { callyou_events(sim); return; } 
+    for (i=0; i<sim->machine.processes; i++) { 
+	Process *q=sim->processes[i]; 
+	uint64_t shown=pentry[i].resident; 
+	if (q) { 
+	    uint64_t cur=PAGEBIT(q->pc/sim->machine.pagesize); 
+	    pentry[i].active=q->active; 
+	    pentry[i].pc=q->pc; 
+	    pentry[i].npages = q->npages; 
+	    pentry[i].resident=q->resident; 
+	    pentry[i].transit=q->transit; 
+	    pentry[i].blocked=(q->active && !(q->resident&cur)) ? cur : 0; 
         } else { 
 	    pentry[i].active=FALSE; 
 	    pentry[i].pc=0; 
 	    pentry[i].npages = 0; 
-	    for (j=0; j<MAXPROCPAGES; j++) pentry[i].pages[j]=FALSE; 
+	    pentry[i].resident=pentry[i].transit=pentry[i].blocked=0; 
         } 
-    pageouts[i] = 0;        // reset pageouts to zero
+	if (!sim->pager->masks_only 	/* compatibility view */ 
+	 && !(keepview && pentry[i].resident==shown)) { 
+	    for (j=0; j<sim->machine.procpages; j++) 
+		pentry[i].pages[j]=(pentry[i].resident>>j)&1; 
+	} 
+    sim->pageouts[i] = 0;        // reset pageouts to zero
     } 
-    pageit(pentry); 	/* call your routine */ 
-} 
-
-int main(int argc, char **argv) { 
-    
-    long i,errors=0,help=0; 
- 
-    signal(SIGINT, endit); 
-    
-    log_port=LOG_ALWAYS; 
-    for (i=1; i<argc; i++) { 
-	if (strcmp(argv[i],"-help")==0) { 
-	    help++;
-	} else if (strcmp(argv[i],"-all")==0) { 
-	    log_port |= LOG_LOAD|LOG_BLOCK|LOG_PAGE|LOG_BRANCH; 
-	} else if (strcmp(argv[i],"-load")==0) { 
-	    log_port |= LOG_LOAD; 
-	} else if (strcmp(argv[i],"-block")==0) { 
-	    log_port |= LOG_BLOCK; 
-	} else if (strcmp(argv[i],"-page")==0) { 
-	    log_port |= LOG_PAGE; 
-	} else if (strcmp(argv[i],"-branch")==0) { 
-	    log_port |= LOG_BRANCH; 
-	} else if (strcmp(argv[i],"-dead")==0) { 
-	    log_port |= LOG_DEAD; 
-	} else if (strcmp(argv[i],"-seed")==0) { 
-	    if (sscanf(argv[++i],"%ld",&seed)!=1) {
-		fprintf(stderr,
-			"%s: could not read random seed from command line\n",
-			argv[0]); 
-		errors++; 
-	    } else if (seed<1 || seed>((1<<30)-1)) {
-		fprintf(stderr,
-			"%s: random seed must be between 1 and %d\n",
-			argv[0], (1<<30)-1); 
-		errors++; 
-	    } 
-	} else if (strcmp(argv[i],"-csv")==0) { 
-	    output = fopen("output.csv", "w"); 
-            if (!output) { 
-		fprintf(stderr,
-			"%s: could not open output.csv for writing\n",
-			argv[0]); 
-		errors++; 
-	    } 
-	    pages = fopen("pages.csv", "w"); 
-            if (!pages) { 
-		fprintf(stderr,
-			"%s: could not open pages.csv for writing\n",
-			argv[0]); 
-		errors++; 
-	    } 
-	} else if (strcmp(argv[i],"-procs")==0) { 
-	    if (sscanf(argv[++i],"%ld",&procs)!=1) {
-		fprintf(stderr,
-			"%s: could not read number of processors from command line\n",
-			argv[0]); 
-		errors++; 
-	    } else if (procs<1 || procs>MAXPROCESSES) {
-		fprintf(stderr,
-			"%s: number of processors must be between 1 and %d\n",
-			argv[0], MAXPROCESSES); 
-		errors++; 
-	    } 
-        } else { 
-	    fprintf(stderr, "t4: unrecognized argument %s\n", argv[i]); 
-	    errors++; 
- 	} 
+    sim->changes = 0; 
+    current_sim = sim; 
+    sim->pager->pageit(sim, pentry, sim->pager_state); 	/* call your routine */ 
+    current_sim = NULL; 
+} 
+
+/* ticks from now in which nothing but counters can change: every 
+   process stays blocked on a page that was already logged as blocking, 
+   no page transfer completes, and the pager sees the same state (or no 
+   events). 0 if the 
+   next tick may differ, or if nothing is in flight at all */ 
+static long allquiet(Simulation *sim) { 
+    long i,quiet=-1; 
+    uint64_t moving; 
+    for (i=0; i<sim->procs; i++) { 
+	Process *q=sim->processes[i]; 
+	long page; 
+	if (!q) { 
+	    if (!empty(sim)) return 0; /* a process will be loaded */ 
+	    continue; 
+	} 
+	if (!q->active) return 0; 
+	page=q->pc/sim->machine.pagesize; 
+	if (q->pages[page]==0 || !(q->blocked&PAGEBIT(page))) return 0; 
+	for (moving=q->transit; moving; moving&=moving-1) { 
+	    long j=__builtin_ctzll(moving), left; 
+	    if (q->pages[j]>0) left=q->pages[j]-1; 	  /* ends pagein */ 
+	    else left=q->pages[j]+sim->machine.pagewait;  /* ends pageout */ 
+	    if (quiet<0 || left<quiet) quiet=left; 
+	} 
     } 
-    if (errors || help) { 
-	fprintf(stderr, "%s usage: %s \n", argv[0], argv[0]); 
-        fprintf(stderr, "  -all       log everything\n"); 
-	fprintf(stderr, "  -load      log loading of processes\n"); 
-	fprintf(stderr, "  -unload    log unloading of processes\n"); 
-	fprintf(stderr, "  -branch    log program branches\n"); 
-	fprintf(stderr, "  -page      log page in and out\n"); 
-	fprintf(stderr, "  -seed 512  set random seed to 512\n"); 
-	fprintf(stderr, "  -procs 4   run only four processors\n"); 
-	fprintf(stderr, "  -dead      detect deadlocks\n"); 
-	fprintf(stderr, "  -csv       generate output.csv and pages.csv for graphing\n");
-	if(errors) {
-	    return EXIT_FAILURE;
-	}
-	else {
-	    return EXIT_SUCCESS;
-	}
+    return quiet>0 ? quiet : 0; 
+} 
+
+/* what allstep, allage and the clock would do in ticks quiet ticks */ 
+static void allskip(Simulation *sim, long ticks) { 
+    long i; 
+    uint64_t moving; 
+    for (i=0; i<sim->procs; i++) { 
+	Process *q=sim->processes[i]; 
+	if (!q) continue; 
+	q->block+=ticks; 
+	for (moving=q->transit; moving; moving&=moving-1) 
+	    q->pages[__builtin_ctzll(moving)]-=ticks; 
     } 
-    if (seed==0) { 
-	seed = (time(NULL)*38491+71831+time(NULL)*time(NULL))&((1<<30)-1); 
+    sim->sysclock+=ticks; 
+    sim->pager->skip(sim, ticks, sim->pager_state); 
+} 
+
+/* a pager written against the original interface */ 
+static void legacy_pageit(Simulation *sim, Pentry q[], void *state) { 
+    (void)sim; (void)state; 
+    pageit(q); 
+} 
+
+static const Pager legacy_pager = { "pageit", NULL, legacy_pageit, NULL, NULL, NULL, FALSE }; 
+
+const Pager *default_pager(void) { 
+    if (&pager && (pager.pageit || pager.events)) return &pager; 
+    if (pageit) return &legacy_pager; 
+    return NULL; 
+} 
+
+/*==================
+   machines
+  ==================*/ 
+
+void machine_init(Machine *m) { 
+    m->processes = MAXPROCESSES; 
+    m->procpages = MAXPROCPAGES; 
+    m->pagesize = PAGESIZE; 
+    m->pagewait = PAGEWAIT; 
+    m->physicalpages = PHYSICALPAGES; 
+    m->queuesize = QUEUESIZE; 
+} 
+
+static int machine_classic(const Machine *m) { 
+    Machine classic; 
+    machine_init(&classic); 
+    return memcmp(m, &classic, sizeof(Machine))==0; 
+} 
+
+const char *machine_check(const Machine *m, const Program *programs, long n) { 
+    long i; 
+    if (m->processes<1) return "there must be at least one processor"; 
+    if (m->procpages<1 || m->procpages>PAGELIMIT) 
+	return "pages per process must be between 1 and 64"; 
+    if (m->pagesize<1) return "page size must be at least 1"; 
+    if (m->pagewait<1) return "page wait must be at least 1"; 
+    if (m->physicalpages<1) return "there must be at least one physical page"; 
+    if (m->queuesize<1) return "there must be at least one process to run"; 
+    /* a pc may reach the size of its program before it restarts */ 
+    if (n<1) return "there must be at least one program"; 
+    for (i=0; i<n; i++) 
+	if (programs[i].size >= m->procpages*m->pagesize) 
+	    return "a program does not fit in the pages of a process"; 
+    return NULL; 
+} 
+
+static const struct { 
+    const char *option; 
+    size_t offset; 
+    const char *usage; 
+} machine_options[] = { 
+    { "-frames",    offsetof(Machine,physicalpages), "physical pages" }, 
+    { "-pagewait",  offsetof(Machine,pagewait),      "ticks one pagein or pageout takes" }, 
+    { "-pagesize",  offsetof(Machine,pagesize),      "size of a page" }, 
+    { "-procpages", offsetof(Machine,procpages),     "pages per process, at most 64" }, 
+    { "-queue",     offsetof(Machine,queuesize),     "processes to run" }, 
+}; 
+
+#define NOPTIONS (long)(sizeof(machine_options)/sizeof(machine_options[0])) 
+
+int machine_option(Machine *m, int argc, char **argv, long *i) { 
+    long k, value; 
+    for (k=0; k<NOPTIONS; k++) { 
+	if (strcmp(argv[*i], machine_options[k].option)!=0) continue; 
+	if (*i+1>=argc || sscanf(argv[*i+1],"%ld",&value)!=1 || value<1) { 
+	    fprintf(stderr, "%s: %s needs a positive number\n", argv[0], argv[*i]); 
+	    if (*i+1<argc) (*i)++; 
+	    return -1; 
+	} 
+	*(long *)((char *)m+machine_options[k].offset) = value; 
+	(*i)++; 
+	return 1; 
     } 
-    srand48(seed); 
-    sim_log(LOG_ALWAYS,"random seed %d\n", seed); 
-    sim_log(LOG_ALWAYS,"using %d processors\n", procs); 
-    
-    allinit(); 
-    while (!alldone()) { // all processes inactive
-	allstep(); 	 // advance time one tick; if process done, reload
-        allage(); 	 // advance time for page wait variables. 
-        callyou(); 	 // call your program
-	sysclock++;      // remember new time. 
-	allblocked();    // deadlock detection 
+    return 0; 
+} 
+
+void machine_usage(FILE *f) { 
+    Machine classic; 
+    long k; 
+    machine_init(&classic); 
+    for (k=0; k<NOPTIONS; k++) 
+	fprintf(f, "  %-10s %-5ld %s\n", machine_options[k].option, 
+	    *(long *)((char *)&classic+machine_options[k].offset), 
+	    machine_options[k].usage); 
+} 
+
+/*==================
+   simulation runs
+  ==================*/ 
+
+void sim_init(Simulation *sim, const Pager *pager, long seed, long procs) { 
+    memset(sim, 0, sizeof(*sim)); 
+    sim->seed = seed; 
+    sim->procs = procs; 
+    machine_init(&sim->machine); 
+    sim->programs = programs; 
+    sim->nprograms = PROGRAMS; 
+    sim->log_port = LOG_ALWAYS; 
+    sim->pager = pager; 
+    /* same sequence srand48(seed) would start */ 
+    sim->xsubi[0] = 0x330E; 
+    sim->xsubi[1] = seed & 0xffff; 
+    sim->xsubi[2] = (seed >> 16) & 0xffff; 
+    seed48_r(sim->xsubi, &sim->rand48); 
+} 
+
+static void sim_free(Simulation *sim) { 
+    free(sim->pageouts); 
+    free(sim->processes); 
+    free(sim->queuetype); 
+    free(sim->queue); 
+    free(sim->pentry); 
+    free(sim->events); 
+    sim->pageouts=NULL; 
+    sim->processes=NULL; 
+    sim->queuetype=NULL; 
+    sim->queue=NULL; 
+    sim->pentry=NULL; 
+    sim->events=NULL; 
+} 
+
+/* size everything from the machine; -1 (with a message) if it cannot be */ 
+static int sim_alloc(Simulation *sim) { 
+    Machine *m=&sim->machine; 
+    const char *why; 
+    if (m->processes<sim->procs) m->processes=sim->procs; 
+    if ((why=machine_check(m,sim->programs,sim->nprograms))) { 
+	fprintf(stderr, "%s\n", why); 
+	return -1; 
+    } 
+    if (sim->pager==&legacy_pager && !machine_classic(m)) { 
+	fprintf(stderr, "pageit is written for the classic machine; define a Pager to run on another\n"); 
+	return -1; 
     } 
-    allscore(); 
+    if (sim->replay && trace_maxpc(sim->replay)>=m->procpages*m->pagesize) { 
+	fprintf(stderr, "trace runs past the pages of a process\n"); 
+	return -1; 
+    } 
+    sim->pageouts=calloc(m->processes, sizeof(int)); 
+    sim->processes=calloc(m->processes, sizeof(Process *)); 
+    sim->queuetype=calloc(m->queuesize, sizeof(long)); 
+    sim->queue=calloc(m->queuesize, sizeof(Process)); 
+    sim->pentry=calloc(m->processes, sizeof(Pentry)); 
+    if (sim->pager->events) sim->events=calloc(MAXEVENTS(m), sizeof(Event)); 
+    if (!sim->pageouts || !sim->processes || !sim->queuetype || !sim->queue 
+     || !sim->pentry || (sim->pager->events && !sim->events)) { 
+	fprintf(stderr, "out of memory for %ld processes\n", m->queuesize); 
+	sim_free(sim); 
+	return -1; 
+    } 
+    sim->pagesavail=m->physicalpages; 
+    return 0; 
+} 
 
-    return EXIT_SUCCESS;
+int sim_run(Simulation *sim) { 
+    long i; 
+    if (sim_alloc(sim)) return -1; 
+    if (sim->replay) { 
+	for (i=0; i<sim->machine.queuesize; i++) { 
+	    /* kinds as initqueue assigns them */ 
+	    if (!trace_has(sim->replay, i, i%sim->nprograms)) { 
+		fprintf(stderr, "trace has no run of process %ld\n", i); 
+		sim_free(sim); 
+		return -1; 
+	    } 
+	} 
+    } 
+    sim_log(sim,LOG_ALWAYS,"random seed %d\n", sim->seed); 
+    sim_log(sim,LOG_ALWAYS,"using %d processors\n", sim->procs); 
+    if (!machine_classic(&sim->machine)) 
+	sim_log(sim,LOG_ALWAYS,"machine: %ld slots, %ld frames, %ld pages of %ld, " 
+	    "page wait %ld, %ld processes\n", sim->machine.processes, 
+	    sim->machine.physicalpages, sim->machine.procpages, 
+	    sim->machine.pagesize, sim->machine.pagewait, sim->machine.queuesize); 
+
+    if (sim->pager->init) { 
+	sim->pager_state = sim->pager->init(sim); 
+	if (!sim->pager_state) { 
+	    fprintf(stderr, "pager %s could not be initialized\n", sim->pager->name); 
+	    sim_free(sim); 
+	    return -1; 
+	} 
+    } 
+
+    allinit(sim); 
+    while (!alldone(sim)) { // all processes inactive
+	allstep(sim); 	 // advance time one tick; if process done, reload
+        allage(sim); 	 // advance time for page wait variables. 
+        callyou(sim); 	 // call your program
+	sim->sysclock++; // remember new time. 
+	if (!allblocked(sim) // deadlock detection, logged every tick
+	 && sim->fast_forward && sim->pager->skip && !sim->changes) { 
+	    long ticks=allquiet(sim); 
+	    if (ticks) allskip(sim,ticks); // jump to the next event
+	} 
+    } 
+    allscore(sim); 
 
+    if (sim->pager->free) sim->pager->free(sim->pager_state); 
+    sim->pager_state = NULL; 
+    sim_free(sim); 
+    return 0; 
 } 
+
+double sim_ratio(const Simulation *sim) { 
+    return (double)sim->block/(double)sim->compute; 
+} 
+
+void sim_print(Simulation *sim) { allprint(sim); }
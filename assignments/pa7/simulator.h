@@ -5,9 +5,17 @@
  *                  http://www.cs.tufts.edu/~couch/
  */
 
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+
 #define TRUE  1
 #define FALSE 0
 
+/* the classic machine; a Simulation may run on another (see Machine) */ 
 #define MAXPROCPAGES    20 	            /* max pages per individual process */ 
 #define MAXPROCESSES    20 	            /* max number of processes in runqueue */ 
 #define PAGESIZE        128 		    /* size of an individual page */ 
@@ -15,21 +23,42 @@
 #define PHYSICALPAGES   100	            /* number of available physical pages */ 
 #define QUEUESIZE       40              /* total number of processes to run */
 #define PROGRAMS        5               /* total number of program types */
+#define PAGELIMIT       64              /* max pages per process on any machine */ 
 
 #define MAXBRANCHES     40	            /* number of branches in a program */ 
 #define MAXEXITS        10	            /* number of maximum exits per program */ 
 #define MAXBRINGS       100	            /* must be EVEN! data points in branch table */ 
 #define MAXPC (MAXPROCPAGES*PAGESIZE)   /* largest PC value */ 
 
+#if MAXPROCPAGES > PAGELIMIT || PAGELIMIT > 64
+#error "page masks hold at most 64 pages per process"
+#endif
+
+#define PAGEBIT(page) ((uint64_t)1<<(page))   /* bit of page in a mask */ 
+
 struct pentry {
     long active; 
     long pc; 
     long npages; 
-    long pages[MAXPROCPAGES]; /* 0 if not allocated, 1 if allocated */ 
+    long pages[PAGELIMIT];    /* 0 if not allocated, 1 if allocated, 
+                                 for the first npages (left unset if 
+                                 Pager.masks_only) */ 
+    uint64_t resident;        /* PAGEBIT(j): page j is allocated */ 
+    uint64_t transit;         /* PAGEBIT(j): page j is being paged in or out */ 
+    uint64_t blocked;         /* PAGEBIT(j): the pc waits for page j */ 
 };
 
 typedef struct pentry Pentry; 
 
+/* logging ports, see Simulation.log_port */ 
+#define LOG_ALWAYS  (1<<0)
+#define LOG_LOAD    (1<<1)
+#define LOG_BLOCK   (1<<2)
+#define LOG_PAGE    (1<<3)
+#define LOG_BRANCH  (1<<4)
+#define LOG_DEAD    (1<<5)
+#define LOG_QUEUE   (1<<9)
+
 /* int pagein (int process, int page)
  *   This pages in the requested page
  * Arguments:
@@ -56,12 +85,15 @@ extern int pageout(int process, int page);
  *   This is called by the simulator
  *   every time something interesting occurs.
  *   It is where you implement the paging strategy.
+ *   A pager may instead define a Pager named pager (see below), which
+ *   keeps its state per simulation; pagein and pageout above then act on
+ *   the simulation whose pager is running on the calling thread.
  * Arguments:   
  *   q: state of every process
  * Returns:
  *   void 
  */
-extern void pageit(Pentry q[MAXPROCESSES]); 
+extern void pageit(Pentry q[MAXPROCESSES]) __attribute__((weak)); 
 
 typedef enum { GOTO, FOR, NFOR, IF } BranchType;
 
@@ -97,16 +129,150 @@ typedef struct bcontext {
 } Bcontext; 
 
 typedef struct process { 
-   Program *program; 
+   const Program *program; 
    long nbcontexts; 
    Bcontext bcontexts[MAXBRANCHES]; 
    long pc; 	            	/* program counter */ 
    long npages; 
-   long pages[MAXPROCPAGES]; 	/* whether page is available */ 
-   long blocked[MAXPROCPAGES];	/* whether we've reported page state */ 
+   long pages[PAGELIMIT]; 	/* whether page is available */ 
+   uint64_t blocked;		/* whether we've reported page state */ 
+   uint64_t resident; 		/* pages[j]==0 */ 
+   uint64_t transit; 		/* pages[j] counting down to in or out */ 
    long active;              	/* whether running now */ 
    long compute; 	    	/* number of compute ticks */ 
    long block; 		    	/* number of blocked ticks */ 
    long pid; 			/* unique process number */ 
    long kind; 			/* kind of process from table */ 
 } Process;
+
+typedef struct simulation Simulation; 
+
+/* one change reported to an event-driven pager (Pager.events) */ 
+typedef enum { EV_LOAD, EV_UNLOAD, EV_PAGEIN, EV_PAGEOUT, EV_PC } EventType; 
+
+typedef struct event { 
+   EventType type; 
+   int proc;         /* process slot */  
+   int page;         /* EV_LOAD, EV_PC: page of the pc now; 
+                        EV_PAGEIN, EV_PAGEOUT: page whose transfer ended */ 
+} Event; 
+
+/* sizes of the machine a simulation runs on. sim_init starts from the 
+   classic machine above; pagers written against the macros only run on 
+   it, a Pager reads sim->machine instead (in init, to size its state) */ 
+typedef struct machine { 
+   long processes;      /* runqueue slots, entries of q; at least procs */ 
+   long procpages;      /* pages per process, at most PAGELIMIT */ 
+   long pagesize; 
+   long pagewait;       /* ticks a pagein or pageout takes */ 
+   long physicalpages; 
+   long queuesize;      /* processes to run */ 
+} Machine; 
+
+/* set m to the classic machine */ 
+extern void machine_init(Machine *m); 
+
+/* NULL if the n programs can run on m, else why not */ 
+extern const char *machine_check(const Machine *m, const Program *programs, long n); 
+
+/* if argv[*i] is an option setting a field of m (-frames 1000 and the 
+   like) read it and its value, advancing *i; 1 if it was one, -1 (with 
+   a message) if its value is bad, 0 if it is some other option */ 
+extern int machine_option(Machine *m, int argc, char **argv, long *i); 
+
+/* usage lines for those options */ 
+extern void machine_usage(FILE *f); 
+
+/* most events one call can carry: every slot unloaded, reloaded and 
+   moved to a new page, and every page of it finishing a transfer */ 
+#define MAXEVENTS(m) ((m)->processes*((m)->procpages+4)) 
+
+/* a paging strategy that keeps its state per simulation, so independent 
+   simulations can run on different threads of one process */ 
+typedef struct pager { 
+   const char *name; 
+   /* allocate the pager's state for sim; NULL init means no state */ 
+   void *(*init)(Simulation *sim); 
+   /* same contract as pageit, with sim_pagein/sim_pageout on sim */ 
+   void (*pageit)(Simulation *sim, Pentry q[], void *state); 
+   /* release what init returned; may be NULL */ 
+   void (*free)(void *state); 
+   /* optional: ticks have passed without a pageit call. Setting it 
+      promises that pageit changes nothing while q stays the same (or 
+      events is called with no events) and never writes to q, so with 
+      fast_forward the simulator may skip such ticks and keep the parts 
+      of q that did not change */ 
+   void (*skip)(Simulation *sim, long ticks, void *state); 
+   /* optional, replaces pageit: called each tick with what changed since 
+      the previous call instead of a snapshot of every process. A slot's 
+      EV_LOAD comes before its other events; a page is resident from its 
+      EV_PAGEIN until the pager pages it out, and EV_UNLOAD releases every 
+      page of the process. Events are in the order they happened */ 
+   void (*events)(Simulation *sim, const Event *ev, int nev, void *state); 
+   /* the pager reads only the masks of Pentry, not pages[] */ 
+   int masks_only; 
+} Pager; 
+
+/* everything one simulation run changes */ 
+struct simulation { 
+   long sysclock; 
+   long seed; 
+   long procs;                      /* processors (runqueue slots) in use */ 
+   Machine machine; 
+   const Program *programs;         /* process i runs programs[i%nprograms] */ 
+   long nprograms; 
+   long log_port;                   /* LOG_* bits written to stderr */ 
+   long pagesavail;                 /* physical pages not assigned */ 
+   unsigned short xsubi[3];         /* erand48_r/nrand48_r state, as srand48(seed) */ 
+   struct drand48_data rand48;      /* their parameters, per simulation: the plain 
+                                       calls share one hidden buffer */ 
+   /* sized from machine by sim_run, NULL outside it */ 
+   int *pageouts;                   /* pageout() requests in this pageit() call */ 
+   Process **processes;             /* machine.processes slots */ 
+   long *queuetype;                 /* machine.queuesize of each */ 
+   Process *queue; 
+   long queueend; 
+   Pentry *pentry;                  /* what pageit gets */ 
+   struct evlog *log;               /* PC and page history, see evlog.h */ 
+   const Pager *pager; 
+   void *pager_state; 
+   Event *events;                   /* not yet given to Pager.events */ 
+   int nevents; 
+   int fast_forward;                /* skip ticks in which nothing can change */ 
+   struct trace *record;            /* pcs executed are written here */ 
+   struct trace *replay;            /* pcs executed come from here, see trace.h */ 
+   long changes;                    /* pageins and pageouts started this tick */ 
+   long block;                      /* totals, set when the run ends */ 
+   long compute; 
+}; 
+
+/* the Pager a pager file may define; without one, pageit is used */ 
+extern Pager pager __attribute__((weak)); 
+
+/* Pager linked into this program: pager if defined, else one wrapping 
+   pageit (not reentrant: such a pager may only run one simulation at a 
+   time). NULL if neither is linked in. */ 
+extern const Pager *default_pager(void); 
+
+/* context forms of pagein/pageout, same arguments and results */ 
+extern int sim_pagein(Simulation *sim, int process, int page); 
+extern int sim_pageout(Simulation *sim, int process, int page); 
+
+/* prepare sim for a run of pager on the classic machine with the 
+   built-in programs; log_port defaults to LOG_ALWAYS and no history is 
+   kept unless log is set before sim_run, and the machine and programs 
+   (see workload.h) may be changed until then too */ 
+extern void sim_init(Simulation *sim, const Pager *pager, long seed, long procs); 
+
+/* run sim until every process has finished; 0 on success, -1 (with a 
+   message) if the machine is unusable or out of memory, or the pager 
+   could not set up its state */ 
+extern int sim_run(Simulation *sim); 
+
+/* blocked/compute ratio of a finished run */ 
+extern double sim_ratio(const Simulation *sim); 
+
+/* print the state of every process to stderr */ 
+extern void sim_print(Simulation *sim);
+
+#endif
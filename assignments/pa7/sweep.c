@@ -0,0 +1,395 @@
+/*
+ * File: sweep.c
+ *
+ * Runs the linked-in pager over many seeds and processor counts at once
+ * and summarizes the blocked/compute ratio of each processor count.
+ *
+ * Pagers that define a Pager run on a pool of threads, each simulation
+ * with its own Simulation. A pager that only defines pageit keeps its
+ * state in statics, so each of its simulations runs in a forked process
+ * of its own instead.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "simulator.h"
+#include "workload.h"
+
+#define MAXTHREADS 256
+#define MAXCOUNTS  64           /* processor counts one sweep can run */
+
+/* outcome of one simulation */
+typedef struct result {
+    int done;                   /* FALSE if the run failed */
+    long block;
+    long compute;
+} Result;
+
+/* jobs [next,end) still queued on one thread; the owner takes from
+   next, thieves split off the top half */
+typedef struct deque {
+    pthread_mutex_t lock;
+    long next;
+    long end;
+} Deque;
+
+typedef struct sweep {
+    const Pager *pager;
+    long first_seed;
+    long nseeds;
+    long procs[MAXCOUNTS]; 	/* processor counts to run */
+    long nprocs;
+    long njobs;                 /* nprocs*nseeds, processor count major */
+    Machine machine;
+    const Program *programs;
+    long nprograms;
+    Result *results;
+    int fast_forward;
+    int nthreads;
+    long unclaimed;             /* jobs no thread has taken yet (atomic) */
+    Deque deques[MAXTHREADS];
+} Sweep;
+
+typedef struct worker {
+    Sweep *sweep;
+    int self;
+} Worker;
+
+/* run job j and record its totals */
+static void run_job(Sweep *sw, long j, Result *r) {
+    Simulation *sim = malloc(sizeof(Simulation));
+    r->done = FALSE;
+    if (!sim) return;
+    sim_init(sim, sw->pager, sw->first_seed + j % sw->nseeds,
+	sw->procs[j / sw->nseeds]);
+    sim->machine = sw->machine;
+    sim->programs = sw->programs;
+    sim->nprograms = sw->nprograms;
+    sim->log_port = 0;
+    sim->fast_forward = sw->fast_forward;
+    if (sim_run(sim) == 0) {
+	r->block = sim->block;
+	r->compute = sim->compute;
+	r->done = TRUE;
+    }
+    free(sim);
+}
+
+/* one pass over the other deques: move the top half of the first one
+   with jobs left onto self's and return its first job; -1 if all were
+   empty when looked at */
+static long steal_job(Sweep *sw, int self) {
+    Deque *d = sw->deques + self;
+    int i;
+
+    for (i = 1; i < sw->nthreads; i++) {
+	Deque *v = sw->deques + (self + i) % sw->nthreads;
+	long lo = 0, hi = 0;
+	pthread_mutex_lock(&v->lock);
+	if (v->next < v->end) {
+	    long half = (v->end - v->next + 1) / 2;
+	    lo = v->end - half;
+	    hi = v->end;
+	    v->end = lo;
+	}
+	pthread_mutex_unlock(&v->lock);
+	if (lo < hi) {
+	    pthread_mutex_lock(&d->lock);
+	    d->next = lo + 1;
+	    d->end = hi;
+	    pthread_mutex_unlock(&d->lock);
+	    return lo;
+	}
+    }
+    return -1;
+}
+
+/* next job for thread self, stealing if its own deque is empty;
+   -1 once every job has been taken */
+static long take_job(Sweep *sw, int self) {
+    Deque *d = sw->deques + self;
+    long job = -1;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->next < d->end) job = d->next++;
+    pthread_mutex_unlock(&d->lock);
+    if (job >= 0) {
+	__atomic_sub_fetch(&sw->unclaimed, 1, __ATOMIC_RELAXED);
+	return job;
+    }
+
+    /* a thief refills its own deque, so jobs can move onto one this pass
+       already found empty (or be between deques mid-steal); only the
+       count of jobs nobody has taken says the sweep is done */
+    while (__atomic_load_n(&sw->unclaimed, __ATOMIC_RELAXED) > 0) {
+	if ((job = steal_job(sw, self)) >= 0) {
+	    __atomic_sub_fetch(&sw->unclaimed, 1, __ATOMIC_RELAXED);
+	    return job;
+	}
+	sched_yield();
+    }
+    return -1;
+}
+
+static void *worker_main(void *arg) {
+    Worker *w = arg;
+    long j;
+    while ((j = take_job(w->sweep, w->self)) >= 0)
+	run_job(w->sweep, j, w->sweep->results + j);
+    return NULL;
+}
+
+static int run_threads(Sweep *sw) {
+    pthread_t tids[MAXTHREADS];
+    Worker workers[MAXTHREADS];
+    int i, started;
+
+    /* each thread starts with an even share of consecutive jobs */
+    sw->unclaimed = sw->njobs;
+    for (i = 0; i < sw->nthreads; i++) {
+	pthread_mutex_init(&sw->deques[i].lock, NULL);
+	sw->deques[i].next = sw->njobs * i / sw->nthreads;
+	sw->deques[i].end = sw->njobs * (i + 1) / sw->nthreads;
+    }
+    for (started = 0; started < sw->nthreads; started++) {
+	workers[started].sweep = sw;
+	workers[started].self = started;
+	if (pthread_create(tids + started, NULL, worker_main, workers + started)) {
+	    /* the threads already running steal the share of the rest */
+	    fprintf(stderr, "sweep: could not start thread %d\n", started);
+	    break;
+	}
+    }
+    if (started == 0) return -1;
+    for (i = 0; i < started; i++) pthread_join(tids[i], NULL);
+    for (i = 0; i < sw->nthreads; i++) pthread_mutex_destroy(&sw->deques[i].lock);
+    return 0;
+}
+
+/* one forked process per simulation, at most nthreads at a time;
+   results come back through a shared mapping */
+static int run_forked(Sweep *sw) {
+    Result *shared;
+    long next = 0;
+    int running = 0;
+
+    shared = mmap(NULL, sw->njobs * sizeof(Result), PROT_READ | PROT_WRITE,
+	MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED) {
+	fprintf(stderr, "sweep: could not map results\n");
+	return -1;
+    }
+    memset(shared, 0, sw->njobs * sizeof(Result));
+
+    fflush(NULL);
+    while (next < sw->njobs || running > 0) {
+	while (running < sw->nthreads && next < sw->njobs) {
+	    pid_t pid = fork();
+	    if (pid == 0) {
+		run_job(sw, next, shared + next);
+		_exit(EXIT_SUCCESS);
+	    }
+	    if (pid < 0) {
+		fprintf(stderr, "sweep: could not fork for seed %ld\n",
+		    sw->first_seed + next % sw->nseeds);
+		if (running > 0) break; /* retry when one finishes */
+		next++;
+		continue;
+	    }
+	    running++;
+	    next++;
+	}
+	if (running > 0 && wait(NULL) > 0) running--;
+    }
+
+    memcpy(sw->results, shared, sw->njobs * sizeof(Result));
+    munmap(shared, sw->njobs * sizeof(Result));
+    return 0;
+}
+
+/* two-sided 95% Student t quantile for df degrees of freedom */
+static double t95(long df) {
+    static const double table[30] = {
+	12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+	2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+	2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (df < 1) return 0;
+    if (df <= 30) return table[df - 1];
+    if (df <= 60) return 2.000;
+    if (df <= 120) return 1.980;
+    return 1.960;
+}
+
+static void report(Sweep *sw) {
+    long c, s;
+    printf("%5s %5s %10s %10s %10s %10s %10s\n",
+	"procs", "runs", "mean", "ci95-low", "ci95-high", "worst", "seed");
+    for (c = 0; c < sw->nprocs; c++) {
+	Result *r = sw->results + c * sw->nseeds;
+	long n = 0, worst_seed = 0;
+	double sum = 0, sumsq = 0, worst = 0, mean, sd, half;
+	for (s = 0; s < sw->nseeds; s++) {
+	    double ratio;
+	    if (!r[s].done) continue;
+	    ratio = (double)r[s].block / (double)r[s].compute;
+	    sum += ratio;
+	    sumsq += ratio * ratio;
+	    if (n == 0 || ratio > worst) {
+		worst = ratio;
+		worst_seed = sw->first_seed + s;
+	    }
+	    n++;
+	}
+	if (n == 0) {
+	    printf("%5ld %5ld %10s\n", sw->procs[c], n, "failed");
+	    continue;
+	}
+	mean = sum / n;
+	sd = n > 1 ? sqrt(fmax(0, (sumsq - n * mean * mean) / (n - 1))) : 0;
+	half = t95(n - 1) * sd / sqrt(n);
+	printf("%5ld %5ld %10.4f %10.4f %10.4f %10.4f %10ld\n",
+	    sw->procs[c], n, mean, mean - half, mean + half, worst, worst_seed);
+	if (n < sw->nseeds)
+	    fprintf(stderr, "sweep: %ld of %ld runs with %ld processors failed\n",
+		sw->nseeds - n, sw->nseeds, sw->procs[c]);
+    }
+}
+
+/* parse a comma separated list of processor counts */
+static int parse_procs(Sweep *sw, char *arg) {
+    char *tok, *save;
+    sw->nprocs = 0;
+    for (tok = strtok_r(arg, ",", &save); tok; tok = strtok_r(NULL, ",", &save)) {
+	long p;
+	if (sw->nprocs >= MAXCOUNTS || sscanf(tok, "%ld", &p) != 1 || p < 1)
+	    return -1;
+	sw->procs[sw->nprocs++] = p;
+    }
+    return sw->nprocs > 0 ? 0 : -1;
+}
+
+int main(int argc, char **argv) {
+    static Sweep sweep;
+    Sweep *sw = &sweep;
+    long i, errors = 0, help = 0, forked = 0;
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    Program *progs = NULL;
+    const char *why;
+    int found;
+
+    sw->first_seed = 1;
+    sw->nseeds = 100;
+    sw->procs[0] = MAXPROCESSES;
+    sw->nprocs = 1;
+    machine_init(&sw->machine);
+    sw->programs = programs;
+    sw->nprograms = PROGRAMS;
+    for (i = 1; i < argc; i++) {
+	if ((found = machine_option(&sw->machine, argc, argv, &i))) {
+	    if (found < 0) errors++;
+	} else if (strcmp(argv[i], "-help") == 0) {
+	    help++;
+	} else if (strcmp(argv[i], "-fork") == 0) {
+	    forked = 1;
+	} else if (i + 1 < argc && strcmp(argv[i], "-programs") == 0) {
+	    programs_free(progs);
+	    progs = NULL;
+	    if (programs_load(argv[++i], &progs, &sw->nprograms)) errors++;
+	    else sw->programs = progs;
+	} else if (strcmp(argv[i], "-fast") == 0) {
+	    sw->fast_forward = TRUE;
+	} else if (i + 1 < argc && strcmp(argv[i], "-seed") == 0) {
+	    if (sscanf(argv[++i], "%ld", &sw->first_seed) != 1
+	     || sw->first_seed < 1 || sw->first_seed > ((1<<30)-1)) {
+		fprintf(stderr, "%s: first seed must be between 1 and %d\n",
+		    argv[0], (1<<30)-1);
+		errors++;
+	    }
+	} else if (i + 1 < argc && strcmp(argv[i], "-seeds") == 0) {
+	    if (sscanf(argv[++i], "%ld", &sw->nseeds) != 1 || sw->nseeds < 1) {
+		fprintf(stderr, "%s: number of seeds must be at least 1\n", argv[0]);
+		errors++;
+	    }
+	} else if (i + 1 < argc && strcmp(argv[i], "-procs") == 0) {
+	    if (parse_procs(sw, argv[++i])) {
+		fprintf(stderr,
+		    "%s: processor counts must be a list of at most %d positive numbers\n",
+		    argv[0], MAXCOUNTS);
+		errors++;
+	    }
+	} else if (i + 1 < argc && strcmp(argv[i], "-threads") == 0) {
+	    if (sscanf(argv[++i], "%ld", &threads) != 1
+	     || threads < 1 || threads > MAXTHREADS) {
+		fprintf(stderr, "%s: threads must be between 1 and %d\n",
+		    argv[0], MAXTHREADS);
+		errors++;
+	    }
+	} else {
+	    fprintf(stderr, "%s: unrecognized argument %s\n", argv[0], argv[i]);
+	    errors++;
+	}
+    }
+    if (!errors && (why = machine_check(&sw->machine, sw->programs, sw->nprograms))) {
+	fprintf(stderr, "%s: %s\n", argv[0], why);
+	errors++;
+    }
+    if (sw->first_seed + sw->nseeds - 1 > ((1<<30)-1)) {
+	fprintf(stderr, "%s: seeds must stay below %d\n", argv[0], 1<<30);
+	errors++;
+    }
+    if (errors || help) {
+	fprintf(stderr, "%s usage: %s \n", argv[0], argv[0]);
+	fprintf(stderr, "  -seed 1          first random seed\n");
+	fprintf(stderr, "  -seeds 100       number of consecutive seeds to run\n");
+	fprintf(stderr, "  -procs 1,4,20    processor counts to run each seed with\n");
+	fprintf(stderr, "  -threads 8       simulations run at once (default: cores)\n");
+	fprintf(stderr, "  -fork            run each simulation in its own process\n");
+	fprintf(stderr, "  -fast            skip ticks in which every process waits on a page,\n");
+	fprintf(stderr, "                   and the pager view of slots that did not change\n");
+	fprintf(stderr, "  -programs f      run the programs in file f (see genworkload)\n");
+	fprintf(stderr, "machine, default as given:\n");
+	machine_usage(stderr);
+	return errors ? EXIT_FAILURE : EXIT_SUCCESS;
+    }
+
+    sw->pager = default_pager();
+    if (!sw->pager) {
+	fprintf(stderr, "%s: no pager linked in\n", argv[0]);
+	return EXIT_FAILURE;
+    }
+    /* only a Pager keeps its state per simulation */
+    if (!(&pager && sw->pager == &pager)) forked = 1;
+
+    if (threads < 1) threads = 1;
+    if (threads > MAXTHREADS) threads = MAXTHREADS;
+    sw->njobs = sw->nprocs * sw->nseeds;
+    if (threads > sw->njobs) threads = sw->njobs;
+    sw->nthreads = threads;
+    sw->results = calloc(sw->njobs, sizeof(Result));
+    if (!sw->results) {
+	fprintf(stderr, "%s: out of memory\n", argv[0]);
+	return EXIT_FAILURE;
+    }
+
+    printf("pager %s: seeds %ld-%ld, %d %s\n", sw->pager->name,
+	sw->first_seed, sw->first_seed + sw->nseeds - 1, sw->nthreads,
+	forked ? "processes" : "threads");
+    if ((forked ? run_forked(sw) : run_threads(sw)) == -1) {
+	free(sw->results);
+	return EXIT_FAILURE;
+    }
+    report(sw);
+
+    free(sw->results);
+    programs_free(progs);
+    return EXIT_SUCCESS;
+}
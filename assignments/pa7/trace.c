@@ -0,0 +1,304 @@
+/*
+ * File: trace.c
+ *
+ * Reading and writing reference traces, see trace.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+/* one process of a trace being recorded */
+typedef struct recording {
+    unsigned char *buf;         /* encoded runs so far */
+    size_t len, cap;
+    long nruns;
+    long start, count;          /* run being extended; count 0 if none */
+    long end;                   /* last pc of the previous run */
+    long kind;
+} Recording;
+
+/* one process of a trace being replayed */
+typedef struct cursor {
+    const unsigned char *first; /* its first run */
+    long nruns;
+    long kind;
+    int present;
+    const unsigned char *pos;   /* next run to decode */
+    long pc;                    /* current pc */
+    long left;                  /* pcs after pc in the current run */
+    long runs;                  /* runs not yet decoded */
+} Cursor;
+
+struct trace {
+    FILE *f;
+    long seed;
+    int failed;
+    Recording *rec;             /* by pid, grown as pids show up */
+    long nrec;
+    unsigned char *data;        /* whole file, when replaying */
+    size_t size;
+    Cursor *cur;                /* by pid */
+    long ncur;
+    long maxpc;
+};
+
+/* largest pc or run length a trace may hold, to keep sums in range */
+#define TRACE_PCLIMIT (1L << 40)
+
+static int put_varint(FILE *f, uint64_t v) {
+    while (v >= 0x80) {
+	if (putc((int)(v & 0x7f) | 0x80, f) == EOF) return -1;
+	v >>= 7;
+    }
+    return putc((int)v, f) == EOF ? -1 : 0;
+}
+
+static int buf_varint(Recording *r, uint64_t v) {
+    if (r->cap - r->len < 10) {
+	size_t cap = r->cap ? r->cap * 2 : 256;
+	unsigned char *grown = realloc(r->buf, cap);
+	if (!grown) return -1;
+	r->buf = grown;
+	r->cap = cap;
+    }
+    while (v >= 0x80) {
+	r->buf[r->len++] = (unsigned char)((v & 0x7f) | 0x80);
+	v >>= 7;
+    }
+    r->buf[r->len++] = (unsigned char)v;
+    return 0;
+}
+
+/* decode one varint from [*p,end); FALSE if it runs past the end */
+static int get_varint(const unsigned char **p, const unsigned char *end, uint64_t *v) {
+    int shift = 0;
+    *v = 0;
+    while (*p < end && shift < 64) {
+	unsigned char b = *(*p)++;
+	*v |= (uint64_t)(b & 0x7f) << shift;
+	if (!(b & 0x80)) return TRUE;
+	shift += 7;
+    }
+    return FALSE;
+}
+
+static uint64_t zigzag(long v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static long unzigzag(uint64_t v) { return (long)(v >> 1) ^ -(long)(v & 1); }
+
+Trace *trace_create(FILE *f, long seed) {
+    Trace *t = calloc(1, sizeof(Trace));
+    if (!t) return NULL;
+    t->f = f;
+    t->seed = seed;
+    if (fwrite(TRACE_MAGIC, 1, 4, f) != 4
+     || put_varint(f, TRACE_VERSION) || put_varint(f, seed))
+	t->failed = TRUE;
+    return t;
+}
+
+static void flush_run(Trace *t, Recording *r) {
+    if (!r->count) return;
+    if (buf_varint(r, zigzag(r->start - (r->end + 1)))
+     || buf_varint(r, r->count))
+	t->failed = TRUE;
+    r->nruns++;
+    r->end = r->start + r->count - 1;
+    r->count = 0;
+}
+
+/* recording of pid, NULL if there is no room for it */
+static Recording *recording(Trace *t, long pid) {
+    if (pid < 0) return NULL;
+    if (pid >= t->nrec) {
+	long i, n = t->nrec ? t->nrec : 64;
+	Recording *grown;
+	while (n <= pid) n *= 2;
+	grown = realloc(t->rec, n * sizeof(Recording));
+	if (!grown) {
+	    t->failed = TRUE;
+	    return NULL;
+	}
+	memset(grown + t->nrec, 0, (n - t->nrec) * sizeof(Recording));
+	for (i = t->nrec; i < n; i++) grown[i].end = -1;
+	t->rec = grown;
+	t->nrec = n;
+    }
+    return t->rec + pid;
+}
+
+void trace_pc(Trace *t, long pid, long kind, long pc) {
+    Recording *r = recording(t, pid);
+    if (!r) return;
+    r->kind = kind;
+    if (r->count && pc == r->start + r->count) {
+	r->count++;
+	return;
+    }
+    flush_run(t, r);
+    r->start = pc;
+    r->count = 1;
+}
+
+int trace_exit(Trace *t, long pid) {
+    Recording *r = recording(t, pid);
+    if (!r) return -1;
+    flush_run(t, r);
+    if (put_varint(t->f, pid + 1) || put_varint(t->f, r->kind)
+     || put_varint(t->f, r->nruns)
+     || (r->len && fwrite(r->buf, 1, r->len, t->f) != r->len))
+	t->failed = TRUE;
+    free(r->buf);
+    memset(r, 0, sizeof(*r));
+    r->end = -1;
+    return t->failed ? -1 : 0;
+}
+
+int trace_close(Trace *t) {
+    int result;
+    long i;
+    if (put_varint(t->f, 0) || fflush(t->f)) t->failed = TRUE;
+    result = t->failed ? -1 : 0;
+    for (i = 0; i < t->nrec; i++) free(t->rec[i].buf);
+    free(t->rec);
+    free(t);
+    return result;
+}
+
+/* position c on its first pc */
+static void cursor_rewind(Trace *t, Cursor *c) {
+    uint64_t d, n;
+    c->pos = c->first;
+    c->runs = c->nruns;
+    c->pc = 0;
+    c->left = 0;
+    if (c->runs > 0) {
+	/* checked when the trace was opened */
+	get_varint(&c->pos, t->data + t->size, &d);
+	get_varint(&c->pos, t->data + t->size, &n);
+	c->pc = unzigzag(d);
+	c->left = (long)n - 1;
+	c->runs--;
+    }
+}
+
+Trace *trace_open(FILE *f, const char *name) {
+    Trace *t = calloc(1, sizeof(Trace));
+    const unsigned char *p, *end;
+    uint64_t v, pid, kind, nruns, d, n;
+    size_t cap = 1 << 16;
+    long i;
+
+    if (!t) return NULL;
+    t->data = malloc(cap);
+    while (t->data) {
+	size_t got = fread(t->data + t->size, 1, cap - t->size, f);
+	t->size += got;
+	if (t->size < cap) break;
+	cap *= 2;
+	unsigned char *grown = realloc(t->data, cap);
+	if (!grown) { free(t->data); t->data = NULL; }
+	else t->data = grown;
+    }
+    if (!t->data || ferror(f)) {
+	fprintf(stderr, "could not read trace %s\n", name);
+	trace_free(t);
+	return NULL;
+    }
+
+    p = t->data;
+    end = t->data + t->size;
+    if (t->size < 4 || memcmp(p, TRACE_MAGIC, 4) != 0) goto bad;
+    p += 4;
+    if (!get_varint(&p, end, &v) || v != TRACE_VERSION) goto bad;
+    if (!get_varint(&p, end, &v)) goto bad;
+    t->seed = (long)v;
+
+    for (;;) {
+	long pc = -1;
+	if (!get_varint(&p, end, &pid)) goto bad;
+	if (pid == 0) break;
+	/* every process takes a few bytes, so this bounds the pids */
+	if (pid > t->size) goto bad;
+	if ((long)pid > t->ncur) {
+	    long n = t->ncur ? t->ncur : 64;
+	    Cursor *grown;
+	    while (n < (long)pid) n *= 2;
+	    grown = realloc(t->cur, n * sizeof(Cursor));
+	    if (!grown) goto bad;
+	    memset(grown + t->ncur, 0, (n - t->ncur) * sizeof(Cursor));
+	    t->cur = grown;
+	    t->ncur = n;
+	}
+	if (t->cur[pid - 1].present) goto bad;
+	if (!get_varint(&p, end, &kind) || !get_varint(&p, end, &nruns))
+	    goto bad;
+	t->cur[pid - 1].first = p;
+	t->cur[pid - 1].nruns = (long)nruns;
+	t->cur[pid - 1].kind = (long)kind;
+	t->cur[pid - 1].present = TRUE;
+	/* every pc must stay in range, so replay can trust it */
+	while (nruns-- > 0) {
+	    if (!get_varint(&p, end, &d) || !get_varint(&p, end, &n)
+	     || n < 1 || n > TRACE_PCLIMIT || d > 2 * TRACE_PCLIMIT)
+		goto bad;
+	    pc += 1 + unzigzag(d);
+	    /* every process starts at pc 0 */
+	    if (pc < 0 || pc + (long)n > TRACE_PCLIMIT
+	     || ((long)nruns + 1 == t->cur[pid - 1].nruns && pc != 0))
+		goto bad;
+	    pc += n - 1;
+	    if (pc > t->maxpc) t->maxpc = pc;
+	}
+    }
+    for (i = 0; i < t->ncur; i++)
+	if (t->cur[i].present) cursor_rewind(t, t->cur + i);
+    return t;
+
+bad:
+    fprintf(stderr, "%s is not a valid trace\n", name);
+    trace_free(t);
+    return NULL;
+}
+
+long trace_seed(const Trace *t) { return t->seed; }
+
+long trace_maxpc(const Trace *t) { return t->maxpc; }
+
+int trace_has(const Trace *t, long pid, long kind) {
+    return pid >= 0 && pid < t->ncur && t->cur[pid].present
+	&& t->cur[pid].nruns > 0 && t->cur[pid].kind == kind;
+}
+
+int trace_next(Trace *t, long pid, long *pc) {
+    Cursor *c = t->cur + pid;
+    uint64_t d, n;
+    if (c->left > 0) {
+	c->left--;
+	*pc = ++c->pc;
+	return TRUE;
+    }
+    if (c->runs == 0) return FALSE;
+    get_varint(&c->pos, t->data + t->size, &d);
+    get_varint(&c->pos, t->data + t->size, &n);
+    c->pc += 1 + unzigzag(d);
+    c->left = (long)n - 1;
+    c->runs--;
+    *pc = c->pc;
+    return TRUE;
+}
+
+void trace_rewind(Trace *t) {
+    long i;
+    for (i = 0; i < t->ncur; i++)
+	if (t->cur[i].present) cursor_rewind(t, t->cur + i);
+}
+
+void trace_free(Trace *t) {
+    if (!t) return;
+    free(t->data);
+    free(t->cur);
+    free(t);
+}
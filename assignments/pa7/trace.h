@@ -0,0 +1,65 @@
+/*
+ * File: trace.h
+ *
+ * Reference traces: the program counters each process executes.
+ *
+ * The branch engine draws all of its random numbers when a process is
+ * loaded, so the pcs a process executes depend only on the seed, never on
+ * the pager. A trace recorded under one pager can drive the simulation
+ * under any other (-record, -replay).
+ *
+ * File format, integers as unsigned LEB128 varints:
+ *   "PA7T" version seed
+ *   per process, in the order they exited:
+ *     pid+1 kind nruns, then nruns runs of consecutive pcs:
+ *       zigzag(start - (end of previous run + 1)) length
+ *   0
+ * The first run starts at pc 0; the last pc of the last run is the exit.
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "simulator.h"
+
+#define TRACE_MAGIC   "PA7T"
+#define TRACE_VERSION 1
+
+typedef struct trace Trace;
+
+/* start recording a run with the given seed into f */
+extern Trace *trace_create(FILE *f, long seed);
+
+/* process pid (of kind) executed the instruction at pc */
+extern void trace_pc(Trace *t, long pid, long kind, long pc);
+
+/* process pid exited: write out everything it executed */
+extern int trace_exit(Trace *t, long pid);
+
+/* finish the file and free t; -1 if anything failed to write */
+extern int trace_close(Trace *t);
+
+/* load a whole trace for reading; NULL (with a message) if it is not one */
+extern Trace *trace_open(FILE *f, const char *name);
+
+extern long trace_seed(const Trace *t);
+
+/* largest pc any process of the trace executes */
+extern long trace_maxpc(const Trace *t);
+
+/* whether the trace holds every process pid of the given kind */
+extern int trace_has(const Trace *t, long pid, long kind);
+
+/* pc executed after the current one by process pid, starting from 0;
+   FALSE if the current one was its exit */
+extern int trace_next(Trace *t, long pid, long *pc);
+
+/* rewind every process to its first pc */
+extern void trace_rewind(Trace *t);
+
+extern void trace_free(Trace *t);
+
+#endif
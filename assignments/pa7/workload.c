@@ -0,0 +1,290 @@
+/*
+ * File: workload.c
+ *
+ * Reading, writing and generating programs, see workload.h.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "simulator.h"
+#include "workload.h"
+
+static const char *btype_names[] = { "GOTO", "FOR", "NFOR", "IF" };
+
+const char *mix_names[MIXES] = { "loop", "scan", "branchy", "phase" };
+
+const char *program_check(const Program *p) {
+    long i;
+    if (p->size < 1) return "program size must be at least 1";
+    if (p->nbranches < 0 || p->nbranches >= MAXBRANCHES)
+	return "too many branches";
+    for (i = 0; i < p->nbranches; i++) {
+	const Branch *b = p->branches + i;
+	if (b->wherefrom < 0 || b->wherefrom >= p->size
+	 || b->whereto < 0 || b->whereto >= p->size)
+	    return "branch outside the program";
+	if (i > 0 && b->wherefrom <= b[-1].wherefrom)
+	    return "branches out of order";
+	if ((b->btype == FOR || b->btype == NFOR)
+	 && (b->min < 1 || b->max < b->min))
+	    return "loop counts must satisfy 1 <= min <= max";
+	if (b->btype == IF && !(b->prob >= 0 && b->prob <= 1))
+	    return "probability must be between 0 and 1";
+    }
+    if (p->nexits < 1 || p->nexits > MAXEXITS) return "too many or no exits";
+    for (i = 0; i < p->nexits; i++) {
+	if (p->exits[i] < 0 || p->exits[i] > p->size) return "exit outside the program";
+	if (i > 0 && p->exits[i] <= p->exits[i - 1]) return "exits out of order";
+    }
+    return NULL;
+}
+
+void programs_free(Program *progs) {
+    free(progs);
+}
+
+static int parse_btype(const char *word, BranchType *t) {
+    long i;
+    for (i = 0; i < 4; i++) {
+	if (strcmp(word, btype_names[i]) == 0) {
+	    *t = (BranchType)i;
+	    return TRUE;
+	}
+    }
+    return FALSE;
+}
+
+int programs_read(FILE *f, const char *name, Program **progs, long *n) {
+    Program *table = NULL, *p = NULL;
+    long count = 0, cap = 0, line = 0;
+    char buf[256], word[16], btype[16], extra[2];
+    const char *why = NULL;
+
+    while (fgets(buf, sizeof(buf), f)) {
+	char *hash = strchr(buf, '#');
+	line++;
+	if (!strchr(buf, '\n') && !feof(f)) { why = "line too long"; goto bad; }
+	if (hash) *hash = '\0';
+	if (sscanf(buf, "%15s", word) != 1) continue;  /* blank */
+
+	if (strcmp(word, "program") == 0) {
+	    if (p) { why = "program inside a program"; goto bad; }
+	    if (count == cap) {
+		long ncap = cap ? 2 * cap : 16;
+		Program *grown = calloc(ncap, sizeof(Program));
+		if (!grown) { why = "out of memory"; goto bad; }
+		if (table) memcpy(grown, table, count * sizeof(Program));
+		programs_free(table);
+		table = grown;
+		cap = ncap;
+	    }
+	    p = table + count;
+	    if (sscanf(buf, "%*s %ld %1s", &p->size, extra) != 1) {
+		why = "expected: program size";
+		goto bad;
+	    }
+	} else if (strcmp(word, "branch") == 0) {
+	    Branch *b;
+	    if (!p) { why = "branch outside a program"; goto bad; }
+	    if (p->nbranches >= MAXBRANCHES - 1) { why = "too many branches"; goto bad; }
+	    b = p->branches + p->nbranches++;
+	    if (sscanf(buf, "%*s %ld %ld %15s %ld %ld %lf %1s", &b->wherefrom,
+		       &b->whereto, btype, &b->min, &b->max, &b->prob, extra) != 6
+	     || !parse_btype(btype, &b->btype)) {
+		why = "expected: branch wherefrom whereto GOTO|FOR|NFOR|IF min max prob";
+		goto bad;
+	    }
+	} else if (strcmp(word, "exit") == 0) {
+	    if (!p) { why = "exit outside a program"; goto bad; }
+	    if (p->nexits >= MAXEXITS) { why = "too many exits"; goto bad; }
+	    if (sscanf(buf, "%*s %ld %1s", p->exits + p->nexits++, extra) != 1) {
+		why = "expected: exit pc";
+		goto bad;
+	    }
+	} else if (strcmp(word, "end") == 0) {
+	    if (!p) { why = "end outside a program"; goto bad; }
+	    if ((why = program_check(p))) goto bad;
+	    p = NULL;
+	    count++;
+	} else {
+	    why = "unknown keyword";
+	    goto bad;
+	}
+    }
+    if (ferror(f)) {
+	fprintf(stderr, "could not read %s\n", name);
+	programs_free(table);
+	return -1;
+    }
+    if (p) { why = "missing end"; goto bad; }
+    if (count == 0) { why = "no programs"; goto bad; }
+    *progs = table;
+    *n = count;
+    return 0;
+
+bad:
+    fprintf(stderr, "%s:%ld: %s\n", name, line, why);
+    programs_free(table);
+    return -1;
+}
+
+int programs_load(const char *name, Program **progs, long *n) {
+    FILE *f = fopen(name, "r");
+    int result;
+    if (!f) {
+	fprintf(stderr, "could not open %s\n", name);
+	return -1;
+    }
+    result = programs_read(f, name, progs, n);
+    fclose(f);
+    return result;
+}
+
+/* shortest form of prob that reads back the same */
+static void put_prob(FILE *f, double prob) {
+    char buf[32];
+    int digits;
+    for (digits = 1; digits < 17; digits++) {
+	snprintf(buf, sizeof(buf), "%.*g", digits, prob);
+	if (strtod(buf, NULL) == prob) break;
+    }
+    snprintf(buf, sizeof(buf), "%.*g", digits, prob);
+    fputs(buf, f);
+}
+
+int programs_write(FILE *f, const Program *progs, long n) {
+    long i, j;
+    for (i = 0; i < n; i++) {
+	const Program *p = progs + i;
+	fprintf(f, "program %ld\n", p->size);
+	for (j = 0; j < p->nbranches; j++) {
+	    const Branch *b = p->branches + j;
+	    fprintf(f, "  branch %ld %ld %s %ld %ld ", b->wherefrom, b->whereto,
+		btype_names[b->btype], b->min, b->max);
+	    put_prob(f, b->prob);
+	    fputc('\n', f);
+	}
+	for (j = 0; j < p->nexits; j++) fprintf(f, "  exit %ld\n", p->exits[j]);
+	fprintf(f, "end\n");
+    }
+    return fflush(f) || ferror(f) ? -1 : 0;
+}
+
+/*============
+   generation
+  ============*/
+
+/* uniform in [lo,hi] */
+static long pick(unsigned short xsubi[3], long lo, long hi) {
+    if (hi <= lo) return lo;
+    return lo + nrand48(xsubi) % (hi - lo + 1);
+}
+
+static double pickp(unsigned short xsubi[3], double lo, double hi) {
+    return lo + erand48(xsubi) * (hi - lo);
+}
+
+/* add a branch unless one already starts at from or the table is full */
+static void add_branch(Program *p, long from, long to, BranchType type,
+		       long min, long max, double prob) {
+    Branch *b;
+    long i;
+    if (p->nbranches >= MAXBRANCHES - 1 || from < 0 || from > p->size - 2
+     || to < 0 || to >= p->size)
+	return;
+    for (i = 0; i < p->nbranches; i++)
+	if (p->branches[i].wherefrom == from) return;
+    b = p->branches + p->nbranches++;
+    b->wherefrom = from;
+    b->whereto = to;
+    b->btype = type;
+    b->min = min;
+    b->max = max;
+    b->prob = prob;
+    b->extent = 0;
+}
+
+static int by_wherefrom(const void *a, const void *b) {
+    long x = ((const Branch *)a)->wherefrom, y = ((const Branch *)b)->wherefrom;
+    return (x > y) - (x < y);
+}
+
+/* a loop over [start,end] taken min to max times, with a loop nested in
+   it half the time */
+static void add_loop(Program *p, long start, long end, long min, long max,
+		     unsigned short xsubi[3]) {
+    if (end - start >= 8 && pick(xsubi, 0, 1)) {
+	long inner = pick(xsubi, start + 1, end - 4);
+	add_loop(p, inner, pick(xsubi, inner + 2, end - 1),
+	    (min + 1) / 2, (max + 1) / 2, xsubi);
+    }
+    add_branch(p, end, start, FOR, min, max, 0);
+}
+
+void program_generate(Program *p, Mix style, long maxsize, long pagesize,
+		      unsigned short xsubi[3]) {
+    long i, n, start, len;
+    memset(p, 0, sizeof(*p));
+    if (pagesize < 8) pagesize = 8;
+
+    switch (style) {
+    case MIX_LOOP:
+	/* a few hot loops of under a page, the rest run once per pass */
+	p->size = pick(xsubi, maxsize / 2, maxsize);
+	n = pick(xsubi, 2, 5);
+	for (i = 0; i < n; i++) {
+	    long lo = (p->size - 2) * i / n, hi = (p->size - 2) * (i + 1) / n - 1;
+	    len = pick(xsubi, pagesize / 4, pagesize);
+	    if (len > hi - lo) len = hi - lo;
+	    start = pick(xsubi, lo, hi - len);
+	    add_loop(p, start, start + len, 5, 20, xsubi);
+	}
+	add_branch(p, p->size - 2, 0, FOR, 2, 6, 0);
+	break;
+
+    case MIX_SCAN:
+	/* every page in order, many times over, sometimes skipping ahead */
+	p->size = pick(xsubi, maxsize * 3 / 4, maxsize);
+	n = pick(xsubi, 0, 3);
+	for (i = 0; i < n; i++) {
+	    start = pick(xsubi, 0, p->size - 3 - pagesize);
+	    add_branch(p, start, start + pick(xsubi, pagesize / 2, pagesize),
+		IF, 0, 0, pickp(xsubi, 0.1, 0.3));
+	}
+	add_branch(p, p->size - 2, 0, FOR, 5, 20, 0);
+	break;
+
+    case MIX_BRANCHY:
+	/* jumps anywhere: mostly forward, rarely back so runs end */
+	p->size = pick(xsubi, maxsize / 2, maxsize);
+	n = pick(xsubi, 15, 35);
+	for (i = 0; i < n; i++) {
+	    long from = pick(xsubi, 0, p->size - 3), to = pick(xsubi, 0, p->size - 3);
+	    add_branch(p, from, to, IF, 0, 0,
+		to > from ? pickp(xsubi, 0.2, 0.8) : pickp(xsubi, 0.02, 0.15));
+	}
+	add_branch(p, p->size - 2, 0, FOR, 1, 3, 0);
+	break;
+
+    case MIX_PHASE:
+	/* loop hard over one region, then move on to the next */
+	p->size = pick(xsubi, maxsize * 3 / 4, maxsize);
+	n = pick(xsubi, 3, 6);
+	for (i = 0; i < n; i++) {
+	    long lo = (p->size - 2) * i / n, hi = (p->size - 2) * (i + 1) / n - 1;
+	    add_loop(p, lo, hi, 3, 10, xsubi);
+	}
+	add_branch(p, p->size - 2, 0, FOR, 1, 2, 0);
+	break;
+
+    default:
+	p->size = maxsize;
+	break;
+    }
+
+    qsort(p->branches, p->nbranches, sizeof(Branch), by_wherefrom);
+    p->nexits = 1;
+    p->exits[0] = p->size - 1;
+}
@@ -0,0 +1,62 @@
+/*
+ * File: workload.h
+ *
+ * Programs beyond the five built into programs.c: reading and writing
+ * them as text, and generating random ones.
+ *
+ * Text format, one item per line, # to the end of a line is a comment:
+ *   program size
+ *   branch wherefrom whereto GOTO|FOR|NFOR|IF min max prob
+ *   exit pc
+ *   end
+ * Branches and exits of a program are in increasing pc order, as
+ * process_step searches them. Each time around, FOR branches (NFOR:
+ * falls through) n times, min <= n < max (n = min if max == min), then
+ * falls through (NFOR: branches) once; IF branches with probability
+ * prob; GOTO always does. min and max only matter to FOR and NFOR, prob
+ * only to IF.
+ */
+
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <stdio.h>
+
+#include "simulator.h"
+
+/* the built-in programs */
+extern Program programs[PROGRAMS];
+
+/* NULL if p is well formed, else why not */
+extern const char *program_check(const Program *p);
+
+/* read every program in f; 0 with *progs and *n set, -1 (with a message
+   naming the line) if f is not a program file */
+extern int programs_read(FILE *f, const char *name, Program **progs, long *n);
+
+/* programs_read of the file called name */
+extern int programs_load(const char *name, Program **progs, long *n);
+
+/* release what programs_read returned */
+extern void programs_free(Program *progs);
+
+/* write n programs so that programs_read gives them back */
+extern int programs_write(FILE *f, const Program *progs, long n);
+
+/* styles of generated program */
+typedef enum {
+    MIX_LOOP,                   /* tight loops over a page or two */
+    MIX_SCAN,                   /* straight through every page */
+    MIX_BRANCHY,                /* IFs jumping between distant pages */
+    MIX_PHASE,                  /* loops over one region, then the next */
+    MIXES
+} Mix;
+
+extern const char *mix_names[MIXES];
+
+/* fill p with a random program of the given style, size at most
+   maxsize (at least 64), shaped for pages of pagesize; draws from xsubi */
+extern void program_generate(Program *p, Mix style, long maxsize,
+			     long pagesize, unsigned short xsubi[3]);
+
+#endif